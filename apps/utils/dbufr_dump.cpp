@@ -20,10 +20,31 @@
 */
 
 #include "bufrfile.h"
+#include "bufrstreamreader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// --exact: numeric values as encoded (mantissa * 10^-scale) instead of 6 significant digits
+static bool exact_values = false;
 
 static void dump_data(const NodeItem* ni,
                       std::ostream& output)
@@ -32,18 +53,22 @@ static void dump_data(const NodeItem* ni,
     const int indent = std::max(ni->depth() - 1, 0);
     const std::string ind(indent * 2, ' ');
 
-    const std::string name = (ind + item.name);
+    const std::string name = (ind + item.name());
     output << std::setw(35) << std::left << name;
 
     output << " " << std::setw(15) << std::right;
 
-    if (item.missing) {
+    if (item.is_missing()) {
         output << "MISSING";
     } else {
         if (!item.values.empty()) {
             const Item::Value value = item.values[0];
             if (value.type == Item::ValueType::Double) {
-                output << value.d;
+                if (exact_values) {
+                    output << Item::decimal_string(value.mantissa, value.scale);
+                } else {
+                    output << value.d;
+                }
             } else {
                 output << ("'" + value.s + "'");
             }
@@ -52,8 +77,8 @@ static void dump_data(const NodeItem* ni,
         }
     }
 
-    output << " " << std::setw(20) << std::left << item.unit;
-    output << " " << std::left << item.description;
+    output << " " << std::setw(20) << std::left << item.unit();
+    output << " " << std::left << item.description();
     output << '\n';
     output << std::right;
 
@@ -64,43 +89,260 @@ static void dump_data(const NodeItem* ni,
     }
 }
 
+static void dump_message(BUFRMessage& m, const unsigned int message_num, std::ostream& output)
+{
+    std::ostringstream ostr;
+    ostr << "Message: " << message_num;
+
+    NodeItem message_nodeitem;
+    Item& item = message_nodeitem.data();
+    item.set_name(ostr.str());
+    item.set_description("...");
+
+    std::vector<std::vector<const NodeItem*>> values_data_nodes;
+    m.decode_data(&message_nodeitem);
+
+    m.dump_section_0(output);
+    m.dump_section_1(output);
+    m.dump_section_2(output);
+    m.dump_section_3(output);
+    m.dump_section_4(output);
+    m.dump_section_5(output);
+
+    for (int j = 1; j <= m.number_of_subsets(); j++) {
+        m.get_values_for_subset(values_data_nodes, j);
+    }
+    dump_data(&message_nodeitem, output);
+    output << "+++++++++" << '\n';
+}
+
+// Decodes and formats messages on a pool of threads, the output is written in file
+// order and is the same as from the serial loop. Every worker takes messages from
+// the front of its own queue, then steals from the back of the other queues, and
+// only then refills its queue with the next few messages of the file. Messages are
+// handed out at most 'window' ahead of the last one written, which bounds the
+// buffered output.
+class ParallelDump
+{
+public:
+    ParallelDump(const BUFRFile& bufr_file, const unsigned int jobs)
+        : m_file(bufr_file)
+        , m_num_messages(bufr_file.num_messages())
+        , m_window(16 * jobs)
+        , m_queues(jobs)
+    {
+        for (auto& queue : m_queues) {
+            queue.reset(new Queue);
+        }
+    }
+
+    void run(std::ostream& output)
+    {
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < m_queues.size(); w++) {
+            workers.emplace_back(&ParallelDump::work, this, w);
+        }
+
+        std::exception_ptr error;
+        for (unsigned int i = 1; i <= m_num_messages && !error; i++) {
+            Result result;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this, i] { return m_results.count(i) != 0; });
+                result = std::move(m_results[i]);
+                m_results.erase(i);
+                m_next_to_write = i + 1;
+                if (result.error) {
+                    m_stop = true;
+                }
+            }
+            m_cv.notify_all();
+
+            // partial output of a failed message too, same as the serial loop
+            output << result.text;
+            error = result.error;
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    ParallelDump(const ParallelDump&) = delete;
+    ParallelDump& operator=(ParallelDump const&) = delete;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<unsigned int> messages;
+    };
+
+    struct Result {
+        std::string text;
+        std::exception_ptr error;
+    };
+
+    static const unsigned int refill_size = 4;
+
+    bool pop(Queue& queue, const bool front, unsigned int& message)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.messages.empty()) {
+            return false;
+        }
+        if (front) {
+            message = queue.messages.front();
+            queue.messages.pop_front();
+        } else {
+            message = queue.messages.back();
+            queue.messages.pop_back();
+        }
+        m_queued--;
+        return true;
+    }
+
+    bool next_message(const size_t worker, unsigned int& message)
+    {
+        while (true) {
+            if (pop(*m_queues[worker], true, message)) {
+                return true;
+            }
+            for (size_t n = 1; n < m_queues.size(); n++) {
+                if (pop(*m_queues[(worker + n) % m_queues.size()], false, message)) {
+                    return true;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_stop || m_next_unassigned > m_num_messages) {
+                return false;
+            }
+            if (m_next_unassigned < m_next_to_write + m_window) {
+                const unsigned int last = std::min(m_next_unassigned + refill_size - 1, m_num_messages);
+                {
+                    std::lock_guard<std::mutex> queue_lock(m_queues[worker]->mutex);
+                    for (unsigned int i = m_next_unassigned; i <= last; i++) {
+                        m_queues[worker]->messages.push_back(i);
+                        m_queued++;
+                    }
+                }
+                m_next_unassigned = last + 1;
+                lock.unlock();
+                // idle workers can steal the rest of the refill
+                m_cv.notify_all();
+                continue;
+            }
+            m_cv.wait(lock, [this] { return m_stop || m_queued > 0 || m_next_unassigned < m_next_to_write + m_window; });
+        }
+    }
+
+    void work(const size_t worker)
+    {
+        unsigned int i = 0;
+        // one decoder per worker, reused for all its messages
+        BUFRMessage m;
+        while (next_message(worker, i)) {
+            std::ostringstream text;
+            Result result;
+            try {
+                m_file.get_message_num(i, m);
+                dump_message(m, i, text);
+            } catch (...) {
+                result.error = std::current_exception();
+            }
+            result.text = text.str();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_results[i] = std::move(result);
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    const BUFRFile& m_file;
+    const unsigned int m_num_messages;
+    const unsigned int m_window;
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<size_t> m_queued{0};
+
+    // guards the members below
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    unsigned int m_next_unassigned{1};
+    unsigned int m_next_to_write{1};
+    std::map<unsigned int, Result> m_results;
+    bool m_stop{false};
+};
+
+static void usage()
+{
+    std::cerr << "Usage: dbufr_dump [--jobs N] [--exact] <bufr_file>" << '\n';
+    std::cerr << "       dbufr_dump [--exact] -    (read from standard input)" << '\n';
+    std::cerr << "  --jobs N  decode N messages at a time, 0 for one per hardware thread" << '\n';
+    std::cerr << "  --exact   print numeric values exactly as encoded, e.g. 149.09248 instead of 149.092" << '\n';
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc != 2) {
-        std::cerr << "Usage: dbufr_dump <bufr_file>" << '\n';
+    unsigned int jobs = 1;
+    int argi = 1;
+    while (argi < argc - 1) {
+        const std::string arg(argv[argi]);
+        if (arg == "--jobs" && argi + 2 < argc) {
+            jobs = (unsigned int)std::strtoul(argv[argi + 1], nullptr, 10);
+            if (jobs == 0) {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+            }
+            argi += 2;
+        } else if (arg == "--exact") {
+            exact_values = true;
+            argi++;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (argi != argc - 1) {
+        usage();
         return 1;
     }
+    const std::string filename = argv[argi];
 
     try {
-        const BUFRFile bufr_file(argv[1]);
+        if (filename == "-") {
+#if defined(_WIN32)
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif
+            BUFRStreamReader reader(std::cin);
+            BUFRMessage m;
+            while (reader.next(m)) {
+                dump_message(m, reader.num_messages(), std::cout);
+            }
+            return 0;
+        }
+
+        if (jobs > 1) {
+            const BUFRFile bufr_file(filename);
+            ParallelDump dump(bufr_file, jobs);
+            dump.run(std::cout);
+            return 0;
+        }
+
+        // messages are decoded in file order
+        BUFRFileOptions options;
+        options.readahead_messages = 16;
+        const BUFRFile bufr_file(filename, options);
 
         // std::cout.setstate(std::ios_base::badbit);
 
+        BUFRMessage m;
         for (unsigned int i = 1; i <= bufr_file.num_messages(); i++) {
-            std::ostringstream ostr;
-            ostr << "Message: " << i;
-
-            NodeItem message_nodeitem;
-            Item& item = message_nodeitem.data();
-            item.name = ostr.str();
-            item.description = "...";
-
-            std::vector<std::vector<const NodeItem*>> values_data_nodes;
-            BUFRMessage m = bufr_file.get_message_num(i);
-            m.decode_data(&message_nodeitem);
-
-            m.dump_section_0(std::cout);
-            m.dump_section_1(std::cout);
-            m.dump_section_2(std::cout);
-            m.dump_section_3(std::cout);
-            m.dump_section_4(std::cout);
-            m.dump_section_5(std::cout);
-
-            for (int j = 1; j <= m.number_of_subsets(); j++) {
-                m.get_values_for_subset(values_data_nodes, j);
-            }
-            dump_data(&message_nodeitem, std::cout);
-            std::cout << "+++++++++" << '\n';
+            bufr_file.get_message_num(i, m);
+            dump_message(m, i, std::cout);
         }
 
     } catch (const std::exception& e) {
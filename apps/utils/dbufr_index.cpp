@@ -0,0 +1,47 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrfile.h"
+
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: dbufr_index <bufr_file> [<bufr_file> ...]" << '\n';
+        return 1;
+    }
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            const BUFRFile bf(argv[i]);
+            bf.write_index();
+            std::cout << argv[i] << ": " << bf.num_messages() << " messages" << '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    } catch (...) {
+        std::cerr << "exception" << '\n';
+        return -1;
+    }
+    return 0;
+}
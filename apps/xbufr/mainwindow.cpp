@@ -260,11 +260,13 @@ void MainWindow::load_message(const int message_num)
 
         auto* message_nodeitem = root_nodeitem->add_child();
         Item& item = message_nodeitem->data();
-        item.name = ostr.str();
-        item.description = "";
+        item.set_name(ostr.str());
+        item.set_description("");
 
         loaded_message = bufrfile->get_message_num(message_num);
 
+        // one message is decoded at a time, its subsets may use all threads
+        loaded_message.set_decode_threads(0);
         loaded_message.decode_data(message_nodeitem);
 
         values_model.begin_reset();
@@ -523,7 +525,7 @@ void MainWindow::tree_selection_changed(const QItemSelection& selected, const QI
     // search for 'Subset' node
     QModelIndex parent_index = index.parent();
     while (parent_index.isValid()) {
-        const QString name = ((NodeModel*)ui->treeView->model())->node_from_index(parent_index)->data().name.c_str();
+        const QString name = ((NodeModel*)ui->treeView->model())->node_from_index(parent_index)->data().name().c_str();
         if (name.startsWith("Subset:")) {
             QStringList parts = name.split(' ');
             assert(parts.size() == 2);
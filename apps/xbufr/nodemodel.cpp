@@ -102,18 +102,18 @@ QVariant NodeModel::data(const QModelIndex& index, int role) const
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
         case Column::Descriptor: {
-            return QString(node->data().name.c_str());
+            return QString(node->data().name().c_str());
         } break;
         case Column::Value: {
             const Item& item = node->data();
-            if (item.missing) {
+            if (item.is_missing()) {
                 return QString("MISSING");
             }
             if (!item.values.empty()) {
                 QString str;
                 const Item::Value value = item.values[0];
                 if (value.type == Item::ValueType::Double) {
-                    const QString unit(item.unit.c_str());
+                    const QString unit(item.unit().c_str());
                     if (unit.startsWith("FLAG", Qt::CaseInsensitive)) {
                         str += QString::number((int)value.d);
                     } else {
@@ -127,10 +127,10 @@ QVariant NodeModel::data(const QModelIndex& index, int role) const
             return QString();
         } break;
         case Column::Unit: {
-            return QString(node->data().unit.c_str());
+            return QString(node->data().unit().c_str());
         } break;
         case Column::Description: {
-            const QString description = node->data().description.c_str();
+            const QString description = node->data().description().c_str();
             if (description.startsWith("TABLE B ENTRY - ")) {
                 return description.mid(16);
             }
@@ -40,13 +40,13 @@ QVariant ValuesModel::headerData(int section, Qt::Orientation orientation, int r
             const int y = item.fxy & 0xff;
             std::ostringstream strstrm;
             strstrm << std::setfill('0') << std::setw(1) << f << std::setw(2) << x << std::setw(3) << y;
-            if (!item.mnemonic.empty()) {
-                strstrm << " " << item.mnemonic;
+            if (!item.mnemonic().empty()) {
+                strstrm << " " << item.mnemonic();
             }
             return QString(strstrm.str().c_str());
         }
         if (role == Qt::ToolTipRole) {
-            return QString(item.description.c_str());
+            return QString(item.description().c_str());
         }
         return {};
     }
@@ -78,13 +78,13 @@ QVariant ValuesModel::data(const QModelIndex& index, int role) const
 
     if (role == Qt::DisplayRole) {
         const Item& item = m_data_nodes[index.row()][index.column()]->data();
-        if (item.missing) {
+        if (item.is_missing(index.column())) {
             return QString("MISSING");
         }
         assert(!item.values.empty());
         const Item::Value value = item.values[index.column()];
         if (value.type == Item::ValueType::Double) {
-            const QString unit(item.unit.c_str());
+            const QString unit(item.unit().c_str());
             if (unit.startsWith("FLAG", Qt::CaseInsensitive)) {
                 return QString::number((int)value.d);
             }
@@ -0,0 +1,147 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Microbenchmark of BitReader::get_int and the bulk BitReader::get_ints for every field
+// width (1 to 32 bits) at every bit alignment (0 to 7). Values are also compared with
+// a bit by bit reference reader.
+//
+//   bitreader_bench [number of fields per width and alignment]
+
+#include "bitreader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static unsigned int reference_get_int(const std::vector<uint8_t>& data, const size_t pos, const unsigned int bits)
+{
+    unsigned int v = 0;
+    for (size_t i = pos; i < pos + bits; i++) {
+        v = (v << 1) | ((data[i >> 3] >> (7 - (i & 7))) & 1U);
+    }
+    return v;
+}
+
+template <BitCheck check>
+static double run(const std::vector<uint8_t>& data, const size_t len_bits, const unsigned int width,
+                  const unsigned int alignment, const size_t num_fields, unsigned int& sum)
+{
+    BitReader br(data.data(), len_bits, 0, data.size());
+    const auto start = std::chrono::steady_clock::now();
+    br.set_pos(alignment);
+    unsigned int s = 0;
+    for (size_t i = 0; i < num_fields; i++) {
+        s += br.get_int<check>(width);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    sum = s;
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)num_fields;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t num_fields = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    const size_t len_bits = 32 * num_fields + 8;
+    std::vector<uint8_t> data((len_bits + 7) / 8 + bitreader_guard_octets);
+    std::mt19937 gen(12345);
+    for (auto& c : data) {
+        c = (uint8_t)gen();
+    }
+
+    // correctness: a sample of positions, and every position in the last octets
+    // (read without 64-bit loads since there are no guard octets here)
+    BitReader br(data.data(), len_bits, 0, (len_bits + 7) / 8);
+    for (unsigned int width = 1; width <= 32; width++) {
+        std::vector<size_t> positions;
+        for (size_t pos = 0; pos + width <= len_bits; pos += 997 * width + 1) {
+            positions.push_back(pos);
+        }
+        for (size_t pos = len_bits - width - 128; pos + width <= len_bits; pos++) {
+            positions.push_back(pos);
+        }
+        for (const size_t pos : positions) {
+            br.set_pos(pos);
+            if (br.get_int(width) != reference_get_int(data, pos, width)) {
+                std::printf("mismatch: width %u position %zu\n", width, pos);
+                return 1;
+            }
+        }
+    }
+
+    // bulk unpacking, same values as one field at a time
+    std::vector<uint32_t> bulk(num_fields);
+    std::printf("bulk unpacking: %s\n", bitunpack_implementation());
+    std::printf("width  get_ints ns/field (alignment 0..7)\n");
+    for (unsigned int width = 1; width <= 32; width++) {
+        std::printf("%5u ", width);
+        for (unsigned int alignment = 0; alignment < 8; alignment++) {
+            BitReader bulk_br(data.data(), len_bits, 0, data.size());
+            bulk_br.set_pos(alignment);
+            const auto start = std::chrono::steady_clock::now();
+            bulk_br.get_ints(width, num_fields, bulk.data());
+            const auto end = std::chrono::steady_clock::now();
+            std::printf(" %5.2f", std::chrono::duration<double, std::nano>(end - start).count() / (double)num_fields);
+
+            br.set_pos(alignment);
+            for (size_t i = 0; i < num_fields; i += 101) {
+                br.set_pos(alignment + i * width);
+                if (br.get_int(width) != bulk[i]) {
+                    std::printf("\nmismatch: get_ints width %u alignment %u field %zu\n", width, alignment, i);
+                    return 1;
+                }
+            }
+        }
+        std::printf("\n");
+    }
+
+    std::printf("width  checked ns/field (alignment 0..7)                  unchecked ns/field (alignment 0..7)\n");
+    unsigned int total = 0;
+    for (unsigned int width = 1; width <= 32; width++) {
+        double checked[8];
+        double unchecked[8];
+        for (unsigned int alignment = 0; alignment < 8; alignment++) {
+            unsigned int sum1;
+            unsigned int sum2;
+            checked[alignment] = run<BitCheck::Checked>(data, len_bits, width, alignment, num_fields, sum1);
+            unchecked[alignment] = run<BitCheck::Unchecked>(data, len_bits, width, alignment, num_fields, sum2);
+            if (sum1 != sum2) {
+                std::printf("mismatch: width %u alignment %u\n", width, alignment);
+                return 1;
+            }
+            total += sum1;
+        }
+        std::printf("%5u ", width);
+        for (const double t : checked) {
+            std::printf(" %5.2f", t);
+        }
+        std::printf("   ");
+        for (const double t : unchecked) {
+            std::printf(" %5.2f", t);
+        }
+        std::printf("\n");
+    }
+    std::printf("checksum %u\n", total);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Heap allocations made per message while decoding a file to columns, with a new
+// BUFRMessage for every message and with one BUFRMessage reused for all of them
+// (BUFRFile::get_message_num(num, message)). Both include the allocations of the
+// columns, three vectors per column.
+//
+//   columns_alloc_bench file.bufr [number of messages]
+
+#include "bufrcolumns.h"
+#include "bufrfile.h"
+#include "bufrmessage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static size_t num_allocations = 0;
+
+void* operator new(size_t size)
+{
+    num_allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+static void run(const BUFRFile& bufrfile, const unsigned int num_messages, const bool reuse)
+{
+    BUFRMessage reused;
+    BUFRColumns columns;
+
+    size_t allocations = 0;
+    unsigned int decoded = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 1; i <= num_messages; i++) {
+        const size_t allocations_before = num_allocations;
+        try {
+            if (reuse) {
+                bufrfile.get_message_num(i, reused);
+                reused.decode_columns(columns);
+            } else {
+                BUFRMessage message = bufrfile.get_message_num(i);
+                message.decode_columns(columns);
+            }
+            decoded++;
+        } catch (const std::exception&) {
+            // messages that can not be decoded to columns are not counted
+        }
+        allocations += num_allocations - allocations_before;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-10s%-24s%.1f\n", reuse ? "reused" : "new", "allocations per message", (double)allocations / num_messages);
+    std::printf("%-10s%-24s%u of %u in %.3f s\n", reuse ? "reused" : "new", "decoded", decoded, num_messages, seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s file.bufr [number of messages]\n", argv[0]);
+        return 1;
+    }
+
+    BUFRFile bufrfile(argv[1]);
+    unsigned int num_messages = bufrfile.num_messages();
+    if (argc > 2) {
+        num_messages = std::min(num_messages, (unsigned int)std::strtoul(argv[2], nullptr, 10));
+    }
+    if (num_messages == 0) {
+        return 0;
+    }
+
+    run(bufrfile, num_messages, false);
+    run(bufrfile, num_messages, true);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Heap allocations made while decoding messages into NodeItem trees, counted by
+// replacing the global operator new. Nodes and child arrays come from the arena
+// of each tree, the remaining allocations are item strings and values.
+//
+//   tree_alloc_bench file.bufr [number of messages]
+
+#include "bufrfile.h"
+#include "bufrmessage.h"
+#include "item.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static size_t num_allocations = 0;
+static size_t allocated_bytes = 0;
+
+void* operator new(size_t size)
+{
+    num_allocations++;
+    allocated_bytes += size;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+static size_t count_nodes(const NodeItem* node)
+{
+    size_t n = 1;
+    for (unsigned int i = 0; i < node->num_children(); i++) {
+        n += count_nodes(node->child(i));
+    }
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s file.bufr [number of messages]\n", argv[0]);
+        return 1;
+    }
+
+    BUFRFile bufrfile(argv[1]);
+    unsigned int num_messages = bufrfile.num_messages();
+    if (argc > 2) {
+        num_messages = std::min(num_messages, (unsigned int)std::strtoul(argv[2], nullptr, 10));
+    }
+
+    size_t total_allocations = 0;
+    size_t total_bytes = 0;
+    size_t total_nodes = 0;
+    size_t total_arena_bytes = 0;
+    size_t total_arena_blocks = 0;
+    double seconds = 0.0;
+
+    for (unsigned int i = 1; i <= num_messages; i++) {
+        BUFRMessage message = bufrfile.get_message_num(i);
+
+        const size_t allocations_before = num_allocations;
+        const size_t bytes_before = allocated_bytes;
+        const auto start = std::chrono::steady_clock::now();
+        {
+            NodeItem root;
+            message.decode_data(&root);
+            total_nodes += count_nodes(&root);
+            total_arena_bytes += root.arena().bytes();
+            total_arena_blocks += root.arena().num_blocks();
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        total_allocations += num_allocations - allocations_before;
+        total_bytes += allocated_bytes - bytes_before;
+    }
+
+    if (num_messages == 0) {
+        return 0;
+    }
+
+    std::printf("%-24s%u\n", "messages", num_messages);
+    std::printf("%-24s%.1f\n", "nodes per message", (double)total_nodes / num_messages);
+    std::printf("%-24s%.1f\n", "allocations per message", (double)total_allocations / num_messages);
+    std::printf("%-24s%.2f\n", "allocations per node", (double)total_allocations / (double)total_nodes);
+    std::printf("%-24s%.0f\n", "bytes per message", (double)total_bytes / num_messages);
+    std::printf("%-24s%.0f in %.1f blocks\n", "arena bytes per message", (double)total_arena_bytes / num_messages, (double)total_arena_blocks / num_messages);
+    std::printf("%-24s%.3f s\n", "decode and free", seconds);
+
+    return 0;
+}
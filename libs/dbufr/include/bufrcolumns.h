@@ -0,0 +1,81 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "item.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One element position of the expanded descriptor list, across all subsets.
+// Numeric values are kept as encoded, value = (raw + reference) * 10^-scale.
+class BUFRColumn
+{
+public:
+    uint16_t fxy{0};
+    bool is_string{false};
+    // after operators 2 01, 2 02, 2 03, 2 06, 2 07 and 2 08
+    int scale{0};
+    int reference{0};
+    int bits{0};
+
+    std::vector<uint64_t> raw{};        // numeric elements, one per subset
+    std::vector<uint64_t> missing{};    // bit (subset % 64) of word (subset / 64)
+    std::vector<std::string> strings{}; // character elements, one per subset
+
+    bool is_missing(const size_t subset) const
+    {
+        return ((missing[subset >> 6] >> (subset & 63)) & 1) != 0;
+    }
+
+    void set_missing(const size_t subset)
+    {
+        missing[subset >> 6] |= 1ULL << (subset & 63);
+    }
+
+    // exact numeric value of one subset, value = mantissa * 10^-scale
+    int64_t mantissa(const size_t subset) const
+    {
+        return (int64_t)raw[subset] + reference;
+    }
+
+    // numeric value of one subset, is_missing must be checked first
+    double value(const size_t subset) const;
+    // numeric values of all subsets
+    void values(std::vector<double>& out, const double missing_value = Item::undef_double_value) const;
+};
+
+// Section 4 decoded to columns, see BUFRMessage::decode_columns
+class BUFRColumns
+{
+public:
+    unsigned int number_of_subsets{0};
+    std::vector<BUFRColumn> columns{};
+
+    void clear()
+    {
+        number_of_subsets = 0;
+        columns.clear();
+    }
+};
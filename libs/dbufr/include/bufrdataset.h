@@ -0,0 +1,66 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "bufrfile.h"
+#include "bufrmessage.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Messages of many files behind one global message index. Table messages (data category 11)
+// are used only for their own file, tables from the database are shared between all files
+// with the same table versions.
+class BUFRDataset
+{
+public:
+    explicit BUFRDataset(const std::vector<std::string>& filenames, const BUFRFileOptions& options = BUFRFileOptions());
+    ~BUFRDataset();
+
+    // regular files in a directory, sorted by name, index files (.idx, .gzidx) excluded
+    static std::vector<std::string> list_directory(const std::string& directory);
+
+    unsigned int num_files() const;
+    const std::string& filename(const unsigned int file_id) const;
+
+    // message_num is 1-based, as in BUFRFile, and counts messages of all files
+    unsigned int num_messages() const;
+    unsigned int file_id(const unsigned int message_num) const;
+    size_t file_offset(const unsigned int message_num) const;
+
+    // Can be called from several threads.
+    BUFRMessage get_message_num(const unsigned int message_num) const;
+
+    // Hands out each message number once, to workers pulling messages from one dataset.
+    // Returns false when all messages were handed out.
+    bool next_message_num(unsigned int& message_num);
+    void rewind();
+
+private:
+    class PrivateData;
+    std::unique_ptr<PrivateData> d;
+
+    BUFRDataset(const BUFRDataset&) = delete;
+    BUFRDataset& operator=(BUFRDataset const&) = delete;
+};
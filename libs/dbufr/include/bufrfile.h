@@ -23,17 +23,73 @@
 
 #include "bufrmessage.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+struct BUFRFileOptions {
+    // threads used to find messages in large files, 0 means one per hardware thread
+    unsigned int scan_threads{0};
+
+    // Sequential access: keep this many messages after the current one in memory
+    // (or ask the OS to), 0 disables readahead. Meant for a single sequential reader,
+    // leave it off when several threads request messages.
+    unsigned int readahead_messages{0};
+};
+
+// Readahead counters, a stall is a message which was not in memory when requested.
+struct BUFRReadStats {
+    uint64_t messages{0};
+    uint64_t stalls{0};
+    double stall_seconds{0.0}; // only measured when messages are read by the I/O thread
+};
+
+// Section 0, 1 and 3 fields of all messages in a file, one vector per field.
+struct BUFRMetadataTable {
+    std::vector<size_t> offset;
+    std::vector<size_t> length;
+    std::vector<int> edition;
+    std::vector<int> master_table_number;
+    std::vector<int> originating_center;
+    std::vector<int> originating_subcenter;
+    std::vector<int> data_cat;
+    std::vector<int> master_table_version;
+    std::vector<int> local_table_version;
+    std::vector<int> year;
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<int> hour;
+    std::vector<int> minute;
+    std::vector<int> second;
+    std::vector<unsigned int> number_of_data_subsets;
+    std::vector<bool> flag_compressed;
+};
+
+// The message index is built in the constructor and not modified afterwards. Files are
+// memory mapped or read with pread (gzip files are inflated under a lock), and each
+// message has its own decoder and buffers, so get_message_num can be called from
+// several threads and the returned messages decoded concurrently. Messages use shared
+// read-only tables (see BUFRMessage::set_shared_tables) and must not outlive the file.
 class BUFRFile
 {
 public:
-    explicit BUFRFile(const std::string& filename);
+    explicit BUFRFile(const std::string& filename, const BUFRFileOptions& options = BUFRFileOptions());
     virtual ~BUFRFile();
 
     BUFRMessage get_message_num(const unsigned int message_num) const;
+    // Same, bm is reset and reused (see BUFRMessage::reset). Threads decoding many messages
+    // should each keep one BUFRMessage for all of them.
+    void get_message_num(const unsigned int message_num, BUFRMessage& bm) const;
+
+    // Only sections 0 to 3 are read, from the index file if there is one.
+    void read_metadata(BUFRMetadataTable& table) const;
+
+    // all zeros unless readahead is enabled
+    BUFRReadStats read_stats() const;
+
+    // write <filename>.idx, reused by later BUFRFile instances while the file is unchanged
+    void write_index() const;
 
     unsigned int num_messages() const;
     unsigned int num_table_messages() const;
@@ -24,8 +24,14 @@
 #include "item.h"
 
 #include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+class BUFRColumns;
 class BUFRDecoder;
+class BUFRSource;
 class TableA;
 class TableB;
 class TableD;
@@ -39,10 +45,9 @@ public:
 
     BUFRMessage& operator=(BUFRMessage&& other) noexcept
     {
-        m_parsed = other.m_parsed;
-        m_decoder = other.m_decoder;
-        other.m_parsed = {};
-        other.m_decoder = {};
+        // swap, the previous decoder is deleted together with other
+        std::swap(m_parsed, other.m_parsed);
+        std::swap(m_decoder, other.m_decoder);
         return *this;
     }
 
@@ -55,6 +60,14 @@ public:
     }
 
     void parse(std::ifstream& ifile, const std::ios::pos_type file_offset);
+    // Sections other than 4 are parsed immediately, section 4 is read from the source when it is decoded.
+    void parse(const std::shared_ptr<BUFRSource>& source, const size_t file_offset, const size_t len_bufr);
+
+    // Drops the parsed message, parse can then be called again. The decoder is kept with its
+    // buffers, containers and the compiled data descriptors of the last message, a message reused
+    // for a stream of messages decodes with few heap allocations besides the tree or the columns.
+    // Projection and decode threads stay set. Trees and columns already decoded are not affected.
+    void reset();
 
     bool is_parsed() const;
 
@@ -64,6 +77,12 @@ public:
                     TableB* const tableb,
                     TableD* const tabled,
                     TableF* const tablef);
+    // Tables shared with messages decoded by other threads. They are only read: table entries
+    // defined in the data (3 00 003, 3 00 004) are decoded but not added, load_tables throws.
+    void set_shared_tables(const TableA* const tablea,
+                           const TableB* const tableb,
+                           const TableD* const tabled,
+                           const TableF* const tablef);
 
     int load_tables();
 
@@ -74,11 +93,47 @@ public:
     void dump_section_4(std::ostream& ostr) const;
     void dump_section_5(std::ostream& ostr) const;
 
+    // Decode only the listed element descriptors, by FXY or by Table B mnemonic. The other elements
+    // are skipped by their width, without items or columns. Elements that other elements depend on
+    // (data present bit-maps, new reference values) are always decoded, and in the tree also the
+    // elements that select the meanings of conditional code and flag tables. Must be set before
+    // decoding, empty lists decode all elements.
+    void set_projection(const std::vector<uint16_t>& descriptors,
+                        const std::vector<std::string>& mnemonics = {});
+
+    // Subsets of uncompressed messages are decoded by up to threads threads, 0 uses all hardware
+    // threads. Only messages with many subsets are split, their data section is skipped through
+    // once more to find where the subsets start. Compressed messages with many subsets are read
+    // once, the increments of their elements are then unpacked in parallel. The tree and the
+    // columns are the same as with one thread (the default). Must be set before decoding.
+    void set_decode_threads(const unsigned int threads);
+
     void decode_data(NodeItem* const nodeitem);
 
     void get_values_for_subset(std::vector<std::vector<const NodeItem*>>& values_data_nodes,
                                const unsigned int subset_num = 0);
 
+    // Decode section 4 to columns instead of a tree. Column n holds the n-th element of every
+    // subset, so all subsets must have the same elements (always true for compressed data).
+    // Delayed replication factors are columns too, new reference values (2 03 YYY) are not.
+    // Throws if the data descriptors define tables or the subsets differ.
+    void decode_columns(BUFRColumns& columns);
+
+    // Uncompressed messages without delayed replication and without data dependent operators
+    // have every element at the same bit offset in every subset. Elements of such messages
+    // can be read directly, without decoding the rest of the data section.
+    bool has_fixed_layout();
+    // Element descriptors of one subset, element numbers below are indices into this list.
+    // Empty if the message does not have a fixed layout.
+    std::vector<uint16_t> layout_descriptors();
+    // subset_num is 1-based
+    Item::Value read_element(const size_t element, const unsigned int subset_num);
+    // element of all subsets
+    void read_element_all_subsets(const size_t element, std::vector<Item::Value>& values);
+
+    // section 0
+    int edition() const;
+
     // section 1
     int master_table_number() const;
     int originating_center() const;
@@ -86,16 +141,25 @@ public:
     int data_cat() const;
     int master_table_version() const;
     int local_table_version() const;
+    int year() const;
+    int month() const;
+    int day() const;
+    int hour() const;
+    int minute() const;
+    int second() const;
 
     // section 3
     unsigned int number_of_data_subsets() const;
     bool flag_observed() const;
     bool flag_compressed() const;
+    std::vector<uint16_t> data_descriptors() const;
 
 private:
     bool m_parsed{false};
     BUFRDecoder* m_decoder{nullptr};
 
+    void reuse_decoder();
+
     BUFRMessage(const BUFRMessage&) = delete;
     BUFRMessage& operator=(BUFRMessage const&) = delete;
 };
@@ -0,0 +1,55 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "bufrmessage.h"
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+
+// Reads BUFR messages one at a time from a non-seekable stream (pipe, stdin...).
+// Bytes between messages are skipped. Memory use is bounded by the largest message.
+class BUFRStreamReader
+{
+public:
+    explicit BUFRStreamReader(std::istream& istr);
+    ~BUFRStreamReader();
+
+    // Returns false at the end of the stream.
+    bool next(BUFRMessage& bm);
+
+    // number of messages returned so far
+    unsigned int num_messages() const;
+
+    // stream offset of the last returned message
+    uint64_t message_offset() const;
+
+    bool has_builtin_tables() const;
+
+private:
+    class PrivateData;
+    std::unique_ptr<PrivateData> d;
+
+    BUFRStreamReader(const BUFRStreamReader&) = delete;
+    BUFRStreamReader& operator=(BUFRStreamReader const&) = delete;
+};
@@ -23,6 +23,7 @@
 
 #include "node.h"
 
+#include <cassert>
 #include <cfloat>
 #include <climits>
 #include <cstdint>
@@ -40,12 +41,16 @@ public:
     enum class ValueType {
         Unknown,
         Double,
-        String
+        String,
+        Missing // a single missing value in compressed data
     };
 
     struct Value {
         std::string s;
         double d{0.0};
+        // numeric values as encoded, d = mantissa * 10^-scale
+        int64_t mantissa{0};
+        int scale{0};
         ValueType type{ValueType::Unknown};
     };
 
@@ -57,6 +62,14 @@ public:
         Sequence
     };
 
+    // Table B metadata of an element descriptor. Instances are interned for
+    // the lifetime of the process and shared by all items of the descriptor.
+    struct ElementInfo {
+        std::string mnemonic;
+        std::string unit;
+        std::string description;
+    };
+
     Item() = default;
 
     Item(const Item&) = delete;
@@ -69,6 +82,12 @@ public:
         return (int)values[0].d;
     }
 
+    // true if all values are missing, or just the value of subset i (compressed data)
+    bool is_missing(const size_t i = 0) const
+    {
+        return missing || (i < values.size() && values[i].type == ValueType::Missing);
+    }
+
     const std::string& as_string() const
     {
         assert(values.size() == 1);
@@ -76,15 +95,103 @@ public:
         return values[0].s;
     }
 
+    // Decimal text of mantissa * 10^-scale without binary rounding, "273.15", "-0.05", "1200"
+    static std::string decimal_string(const int64_t mantissa, const int scale);
+
+    // Display name, built on request from the label, the index in the
+    // expanded descriptor list and the mnemonic of elements.
+    std::string name() const
+    {
+        std::string name;
+        switch (m_label_kind) {
+        case LabelKind::Text:
+            name = m_label;
+            break;
+        case LabelKind::Descriptor:
+            name = fxy_text(m_label_fxy);
+            if (m_label_index >= 0) {
+                name += " (" + std::to_string(m_label_index) + ")";
+            }
+            break;
+        case LabelKind::BitmapReference:
+            name = fxy_text(m_label_fxy);
+            name += " -> [" + std::to_string(m_label_index) + "]";
+            break;
+        }
+        if (m_info == nullptr) {
+            return name;
+        }
+        if (m_expanded_index >= 0) {
+            name += " [" + std::to_string(m_expanded_index) + "]";
+        }
+        name += " ";
+        name += m_info->mnemonic;
+        return name;
+    }
+
+    void set_name(const std::string& label)
+    {
+        m_label = label;
+        m_label_kind = LabelKind::Text;
+    }
+
+    // Label "FXXYYY", followed by " (iteration)" for replicated items
+    void set_label(const uint16_t label_fxy, const int iteration = -1)
+    {
+        m_label_fxy = label_fxy;
+        m_label_index = iteration;
+        m_label_kind = LabelKind::Descriptor;
+    }
+
+    // Label "FXXYYY -> [n]" of an element referenced by a bit-map
+    void set_bitmap_label(const uint16_t label_fxy, const int back_index)
+    {
+        m_label_fxy = label_fxy;
+        m_label_index = back_index;
+        m_label_kind = LabelKind::BitmapReference;
+    }
+
+    const std::string& mnemonic() const
+    {
+        return m_info != nullptr ? m_info->mnemonic : empty_string();
+    }
+
+    const std::string& unit() const
+    {
+        return m_info != nullptr ? m_info->unit : empty_string();
+    }
+
+    // An explicitly set description overrides the one from Table B
+    const std::string& description() const
+    {
+        return (m_info == nullptr || !m_description.empty()) ? m_description : m_info->description;
+    }
+
+    void set_description(const std::string& description)
+    {
+        m_description = description;
+    }
+
+    const ElementInfo* element_info() const
+    {
+        return m_info;
+    }
+
+    void set_element_info(const ElementInfo* info, const int expanded_index = -1)
+    {
+        m_info = info;
+        m_expanded_index = expanded_index;
+    }
+
     friend std::ostream& operator<<(std::ostream& output, const Item& item)
     {
-        if (item.name.empty() && item.unit.empty() && item.description.empty()) {
+        if (item.m_info == nullptr && item.m_label_kind == LabelKind::Text && item.m_label.empty() && item.m_description.empty()) {
             return output;
         }
 
-        output << item.name << " ";
+        output << item.name() << " ";
 
-        if (item.missing) {
+        if (item.is_missing()) {
             output << "MISSING ";
         } else {
             if (!item.values.empty()) {
@@ -97,18 +204,14 @@ public:
             }
         }
 
-        output << item.unit << " ";
-        output << item.description;
+        output << item.unit() << " ";
+        output << item.description();
         return output;
     }
 
     uint16_t fxy{std::numeric_limits<int16_t>::max()};
-    std::string name{};
-    std::string mnemonic{};
     std::vector<Value> values{};
     std::string value_tooltip{};
-    std::string unit{};
-    std::string description{};
 
     int scale{undef_int_value};
     int ref_value{undef_int_value};
@@ -125,6 +228,37 @@ public:
     size_t bits_range_end{0};
 
     Type type{Type::Unknown};
+
+private:
+    enum class LabelKind : uint8_t {
+        Text,
+        Descriptor,
+        BitmapReference
+    };
+
+    static const std::string& empty_string()
+    {
+        static const std::string empty;
+        return empty;
+    }
+
+    static std::string fxy_text(const uint16_t fxy)
+    {
+        const int x = (fxy >> 8) & 0x3f;
+        const int y = fxy & 0xff;
+        const char text[6] = {char('0' + ((fxy >> 14) & 0x3)),
+                              char('0' + x / 10), char('0' + x % 10),
+                              char('0' + y / 100), char('0' + y / 10 % 10), char('0' + y % 10)};
+        return std::string(text, 6);
+    }
+
+    std::string m_label{};
+    std::string m_description{};
+    const ElementInfo* m_info{nullptr};
+    int m_expanded_index{-1};
+    int m_label_index{-1};
+    uint16_t m_label_fxy{0};
+    LabelKind m_label_kind{LabelKind::Text};
 };
 
 using NodeItem = Node<Item>;
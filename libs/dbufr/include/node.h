@@ -21,19 +21,150 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
 #include <vector>
 
+// Monotonic memory for the nodes of one tree. Nothing is freed before the
+// arena, which releases all nodes and child arrays at once.
+class NodeArena
+{
+public:
+    NodeArena() = default;
+
+    void* allocate(const size_t size)
+    {
+        const size_t n = (size + alignment - 1) & ~(alignment - 1);
+        if (n > m_left) {
+            if (n > max_block_size / 4) {
+                // large child arrays get their own block
+                m_blocks.emplace_back(new char[n]);
+                m_bytes += n;
+                return m_blocks.back().get();
+            }
+            // blocks grow, small trees stay small
+            const size_t block_size = std::max(n, m_block_size);
+            m_blocks.emplace_back(new char[block_size]);
+            m_current = m_blocks.back().get();
+            m_left = block_size;
+            m_block_size = std::min(2 * m_block_size, (size_t)max_block_size);
+        }
+        void* p = m_current;
+        m_current += n;
+        m_left -= n;
+        m_bytes += n;
+        return p;
+    }
+
+    // An arena released together with this one. Nodes of a tree can be allocated in
+    // several arenas, which lets separate threads build separate subtrees.
+    NodeArena* add_arena()
+    {
+        m_arenas.emplace_back(new NodeArena);
+        return m_arenas.back().get();
+    }
+
+    size_t num_blocks() const
+    {
+        size_t n = m_blocks.size();
+        for (const auto& arena : m_arenas) {
+            n += arena->num_blocks();
+        }
+        return n;
+    }
+
+    size_t bytes() const
+    {
+        size_t n = m_bytes;
+        for (const auto& arena : m_arenas) {
+            n += arena->bytes();
+        }
+        return n;
+    }
+
+private:
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(NodeArena const&) = delete;
+
+    static constexpr size_t alignment = alignof(std::max_align_t);
+    static constexpr size_t max_block_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> m_blocks{};
+    size_t m_block_size{4 * 1024};
+    char* m_current{nullptr};
+    size_t m_left{0};
+    size_t m_bytes{0};
+    std::vector<std::unique_ptr<NodeArena>> m_arenas{};
+};
+
+template <class T>
+class NodeArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit NodeArenaAllocator(NodeArena* const arena)
+        : m_arena(arena)
+    {
+    }
+
+    template <class U>
+    NodeArenaAllocator(const NodeArenaAllocator<U>& other)
+        : m_arena(other.arena())
+    {
+    }
+
+    T* allocate(const size_t n)
+    {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* const, const size_t)
+    {
+        // released with the arena
+    }
+
+    NodeArena* arena() const
+    {
+        return m_arena;
+    }
+
+    bool operator==(const NodeArenaAllocator& other) const
+    {
+        return m_arena == other.m_arena;
+    }
+
+    bool operator!=(const NodeArenaAllocator& other) const
+    {
+        return m_arena != other.m_arena;
+    }
+
+private:
+    NodeArena* m_arena;
+};
+
+// A tree node. The root owns the arena of the tree, all other nodes and the
+// child arrays are allocated in it and freed together with the root.
 template <class T>
 class Node
 {
 public:
-    Node() = default;
+    typedef std::vector<Node*, NodeArenaAllocator<Node*>> ChildList;
+
+    Node()
+        : m_owned_arena(new NodeArena)
+        , m_arena(m_owned_arena.get())
+        , m_children(NodeArenaAllocator<Node*>(m_arena))
+    {
+    }
 
     ~Node()
     {
         for (unsigned int i = 0; i < m_children.size(); i++) {
-            delete m_children[i];
+            m_children[i]->~Node();
         }
     }
 
@@ -83,7 +214,7 @@ public:
         return (num_children() > 0);
     }
 
-    std::vector<Node*>& children() const
+    const ChildList& children() const
     {
         return m_children;
     }
@@ -98,7 +229,13 @@ public:
 
     Node* add_child()
     {
-        Node* child_node = new Node();
+        return add_child(m_arena);
+    }
+
+    // The child and its subtree are allocated in arena, see NodeArena::add_arena
+    Node* add_child(NodeArena* const arena)
+    {
+        Node* child_node = new (arena->allocate(sizeof(Node))) Node(arena);
         child_node->set_depth(m_depth + 1);
         child_node->set_parent(this);
         m_children.push_back(child_node);
@@ -115,11 +252,31 @@ public:
         return m_depth;
     }
 
+    // arena of the whole tree
+    const NodeArena& arena() const
+    {
+        return *m_arena;
+    }
+
+    NodeArena* add_arena()
+    {
+        return m_arena->add_arena();
+    }
+
 private:
+    explicit Node(NodeArena* const arena)
+        : m_arena(arena)
+        , m_children(NodeArenaAllocator<Node*>(arena))
+    {
+    }
+
     Node(const Node&) = delete;
     Node& operator=(Node const&) = delete;
 
-    std::vector<Node*> m_children{};
+    // destroyed after the children
+    std::unique_ptr<NodeArena> m_owned_arena{};
+    NodeArena* m_arena{nullptr};
+    ChildList m_children;
     Node* m_parent{nullptr};
     T m_data{};
     int m_depth{0};
@@ -23,37 +23,22 @@
 
 #include "fmt/format.h"
 
-#include <array>
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 
-BitReader::BitReader(const uint8_t* const data, const size_t len, const size_t off)
+BitReader::BitReader(const uint8_t* const data, const size_t len, const size_t off, const size_t readable)
     : buffer(data)
     , length(data != nullptr ? len : 0)
     , bit_pos(0)
     , offset(off)
-    , debug(false)
+    , readable_octets(data != nullptr ? std::max(readable, (len + 7) / 8) : 0)
 {
 }
 
-size_t BitReader::get_pos() const
-{
-    return bit_pos;
-}
-
-void BitReader::set_pos(const size_t pos)
-{
-    bit_pos = pos;
-}
-
-size_t BitReader::get_remaining_bits() const
-{
-    return length - bit_pos;
-}
-
 void BitReader::skip_bits(const unsigned int bits)
 {
     if (debug) {
@@ -67,12 +52,8 @@ void BitReader::skip_bits(const unsigned int bits)
     bit_pos += bits;
 }
 
-unsigned int BitReader::get_int(const unsigned int bits)
+void BitReader::get_int_error(const unsigned int bits) const
 {
-    if (debug) {
-        std::cerr << "\nBitReader::get_int " << bit_pos + offset << " bits " << bits;
-    }
-
     if (bits <= 0) {
         throw std::runtime_error(fmt::format("BitReader::get_int bits <= 0. bits = {}", bits));
     }
@@ -81,49 +62,12 @@ unsigned int BitReader::get_int(const unsigned int bits)
         throw std::runtime_error(fmt::format("BitReader::get_int bits > 32. bits = {}", bits));
     }
 
-    if (bit_pos + bits > length) {
-        throw std::runtime_error(fmt::format("BitReader::get_int can not go past the end of the buffer. cursor_position: {} bits: {} length: {}", bit_pos, bits, length));
-    }
-
-    static const std::array<unsigned int, 33> bitmask = {
-        0x00000000U,
-        0x00000001U,
-        0x00000003U,
-        0x00000007U,
-        0x0000000fU,
-        0x0000001fU,
-        0x0000003fU,
-        0x0000007fU,
-        0x000000ffU,
-        0x000001ffU,
-        0x000003ffU,
-        0x000007ffU,
-        0x00000fffU,
-        0x00001fffU,
-        0x00003fffU,
-        0x00007fffU,
-        0x0000ffffU,
-        0x0001ffffU,
-        0x0003ffffU,
-        0x0007ffffU,
-        0x000fffffU,
-        0x001fffffU,
-        0x003fffffU,
-        0x007fffffU,
-        0x00ffffffU,
-        0x01ffffffU,
-        0x03ffffffU,
-        0x07ffffffU,
-        0x0fffffffU,
-        0x1fffffffU,
-        0x3fffffffU,
-        0x7fffffffU,
-        0xffffffffU};
-
-    //   octet
-    // ******** ******** ******** ********
-    //    +++++ ++++++++ ++                   bits = 15
+    throw std::runtime_error(fmt::format("BitReader::get_int can not go past the end of the buffer. cursor_position: {} bits: {} length: {}", bit_pos, bits, length));
+}
 
+// Fields in the last 8 readable octets, one octet at a time.
+unsigned int BitReader::get_int_tail(const unsigned int bits) const
+{
     size_t octet = bit_pos >> 3UL;            // Which octet the word starts in, faster than 'bit_pos / 8'
     const size_t startbit = bit_pos & 0x07UL; // Offset from start of octet to start of word, faster than 'bit_pos % 8'
 
@@ -149,12 +93,6 @@ unsigned int BitReader::get_int(const unsigned int bits)
         }
     }
 
-    bit_pos += bits;
-
-    if (debug) {
-        std::cerr << " ival = " << ival << '\n';
-    }
-
     return ival;
 }
 
@@ -21,34 +21,135 @@
 
 #pragma once
 
+#include "bitunpack.h"
+#include "bitutils.h"
+
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <string>
 
+// Octets after the last octet of the data that BitReader may load. Buffers allocated
+// by the decoder are this much larger, so every field can be read with one 64-bit load.
+static const size_t bitreader_guard_octets = 8;
+
+// Checked validates the width (1 to 32) and the end of the buffer on every read.
+// Unchecked is for spans the caller has already validated, see BitReader::has_bits.
+enum class BitCheck {
+    Checked,
+    Unchecked
+};
+
 class BitReader
 {
 public:
+    // len is in bits, off is the bit offset of data in the message (for messages only).
+    // readable is the number of octets starting at data that may be loaded, including
+    // guard octets. If it is smaller than (len + 7) / 8 + 8, fields near the end are
+    // read one octet at a time.
     BitReader(const uint8_t* const data,
               const size_t len,
-              const size_t off);
+              const size_t off,
+              const size_t readable = 0);
 
     size_t get_pos() const;
     void set_pos(const size_t pos);
     size_t get_remaining_bits() const;
+    bool has_bits(const size_t bits) const;
 
     void skip_bits(const unsigned int bits);
+    template <BitCheck check = BitCheck::Checked>
     unsigned int get_int(const unsigned int bits);
+    // n consecutive fields of the same width
+    template <BitCheck check = BitCheck::Checked>
+    void get_ints(const unsigned int bits, const size_t n, uint32_t* out);
     std::string get_string(const unsigned int bits);
 
 private:
     static const size_t octet_width = 8UL;
+    static const bool debug = false;
+
+    [[noreturn]] void get_int_error(const unsigned int bits) const;
+    unsigned int get_int_tail(const unsigned int bits) const;
 
     const uint8_t* const buffer;
     const size_t length;
     size_t bit_pos;
     const size_t offset;
-    const bool debug;
+    const size_t readable_octets;
 
     BitReader(const BitReader&) = delete;
     BitReader& operator=(BitReader const&) = delete;
 };
+
+inline size_t BitReader::get_pos() const
+{
+    return bit_pos;
+}
+
+inline void BitReader::set_pos(const size_t pos)
+{
+    bit_pos = pos;
+}
+
+inline size_t BitReader::get_remaining_bits() const
+{
+    return length - bit_pos;
+}
+
+inline bool BitReader::has_bits(const size_t bits) const
+{
+    return bits <= length - bit_pos;
+}
+
+template <BitCheck check>
+inline unsigned int BitReader::get_int(const unsigned int bits)
+{
+    // bits - 1 wraps around for bits == 0
+    if (check == BitCheck::Checked && (bits - 1 >= 32U || bits > length - bit_pos)) {
+        get_int_error(bits);
+    }
+
+    //   octet
+    // ******** ******** ******** ******** ******** ******** ******** ********
+    //    +++++ ++++++++ ++                                                      bits = 15
+
+    const size_t octet = bit_pos >> 3UL;                          // Which octet the word starts in
+    const unsigned int startbit = (unsigned int)(bit_pos & 0x07UL); // Offset from start of octet to start of word
+
+    unsigned int ival;
+    if (octet + 8 <= readable_octets) {
+        // startbit + bits <= 39, the word is always within the 8 loaded octets
+        ival = (unsigned int)((load_be64(buffer + octet) << startbit) >> (64 - bits));
+    } else {
+        ival = get_int_tail(bits);
+    }
+
+    bit_pos += bits;
+
+    return ival;
+}
+
+template <BitCheck check>
+inline void BitReader::get_ints(const unsigned int bits, const size_t n, uint32_t* out)
+{
+    if (check == BitCheck::Checked && (bits - 1 >= 32U || !has_bits((size_t)bits * n))) {
+        get_int_error(bits);
+    }
+
+    // fields whose 8 octets are all readable go to the bulk kernel, the rest (near the end) one by one
+    size_t nbulk = 0;
+    if (readable_octets >= 8) {
+        const size_t last_bulk_pos = (readable_octets - 8) * 8 + 7;
+        if (bit_pos <= last_bulk_pos) {
+            nbulk = std::min(n, (last_bulk_pos - bit_pos) / bits + 1);
+        }
+    }
+
+    unpack_bits(buffer, bit_pos, bits, nbulk, out);
+    bit_pos += nbulk * bits;
+
+    for (size_t i = nbulk; i < n; i++) {
+        out[i] = get_int<BitCheck::Unchecked>(bits);
+    }
+}
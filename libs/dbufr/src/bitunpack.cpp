@@ -0,0 +1,177 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitunpack.h"
+
+#include "bitutils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DBUFR_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+static void unpack_bits_scalar(const uint8_t* data, const size_t bit_pos, const unsigned int bits,
+                               const size_t n, uint32_t* out)
+{
+    size_t pos = bit_pos;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (uint32_t)((load_be64(data + (pos >> 3)) << (pos & 7)) >> (64 - bits));
+        pos += bits;
+    }
+}
+
+static size_t decode_increments_scalar(const uint32_t* increments, const size_t n, const unsigned int bits,
+                                       const int64_t base, const DecimalScale scale, const bool check_missing,
+                                       double* values, uint8_t* missing)
+{
+    // base + increment is an integer well below 2^53, exact in double
+    const double dbase = (double)base;
+    const uint32_t all_ones = bitmask[bits];
+    size_t num_missing = 0;
+    for (size_t i = 0; i < n; i++) {
+        values[i] = scale.apply(dbase + (double)increments[i]);
+        const uint8_t m = (check_missing && increments[i] == all_ones) ? 1 : 0;
+        missing[i] = m;
+        num_missing += m;
+    }
+    return num_missing;
+}
+
+#if defined(DBUFR_AVX2_DISPATCH)
+
+// 8 fields per iteration: gather the 8 octets of each field, byte swap to big-endian
+// order, shift the field to the top of the 64-bit lane and then down to the bottom.
+__attribute__((target("avx2"))) static void unpack_bits_avx2(const uint8_t* data, const size_t bit_pos, const unsigned int bits,
+                                                              const size_t n, uint32_t* out)
+{
+    const __m256i bswap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i seven = _mm256_set1_epi64x(7);
+    const __m256i right = _mm256_set1_epi64x(64 - bits);
+    const __m256i step = _mm256_set1_epi64x(4 * (long long)bits);
+    const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    __m256i pos = _mm256_setr_epi64x((long long)bit_pos, (long long)(bit_pos + bits),
+                                     (long long)(bit_pos + 2 * bits), (long long)(bit_pos + 3 * bits));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i w[2];
+        for (int h = 0; h < 2; h++) {
+            const __m256i octet = _mm256_srli_epi64(pos, 3);
+            __m256i v = _mm256_i64gather_epi64((const long long*)data, octet, 1);
+            v = _mm256_shuffle_epi8(v, bswap);
+            v = _mm256_sllv_epi64(v, _mm256_and_si256(pos, seven));
+            w[h] = _mm256_srlv_epi64(v, right);
+            pos = _mm256_add_epi64(pos, step);
+        }
+        // low 32 bits of the 8 lanes
+        const __m128i lo = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(w[0], pack));
+        const __m128i hi = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(w[1], pack));
+        _mm_storeu_si128((__m128i*)(out + i), lo);
+        _mm_storeu_si128((__m128i*)(out + i + 4), hi);
+    }
+
+    unpack_bits_scalar(data, bit_pos + i * bits, bits, n - i, out + i);
+}
+
+__attribute__((target("avx2"))) static size_t decode_increments_avx2(const uint32_t* increments, const size_t n, const unsigned int bits,
+                                                                      const int64_t base, const DecimalScale scale, const bool check_missing,
+                                                                      double* values, uint8_t* missing)
+{
+    const __m256d vbase = _mm256_set1_pd((double)base);
+    const __m256d vfactor = _mm256_set1_pd(scale.factor());
+    // unsigned to double: flip the sign bit, convert as signed, add 2^31
+    const __m128i sign = _mm_set1_epi32((int)0x80000000U);
+    const __m256d two31 = _mm256_set1_pd(2147483648.0);
+    const __m128i all_ones = _mm_set1_epi32((int)bitmask[bits]);
+
+    size_t num_missing = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i inc = _mm_loadu_si128((const __m128i*)(increments + i));
+        const __m256d d = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(inc, sign)), two31);
+        const __m256d mantissa = _mm256_add_pd(vbase, d);
+        _mm256_storeu_pd(values + i, scale.divide() ? _mm256_div_pd(mantissa, vfactor) : _mm256_mul_pd(mantissa, vfactor));
+
+        int mask = 0;
+        if (check_missing) {
+            mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(inc, all_ones)));
+        }
+        for (int k = 0; k < 4; k++) {
+            missing[i + k] = (uint8_t)((mask >> k) & 1);
+        }
+        num_missing += (size_t)__builtin_popcount((unsigned int)mask);
+    }
+
+    return num_missing + decode_increments_scalar(increments + i, n - i, bits, base, scale, check_missing, values + i, missing + i);
+}
+
+static bool cpu_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+#endif // DBUFR_AVX2_DISPATCH
+
+typedef void (*UnpackBitsFunc)(const uint8_t*, const size_t, const unsigned int, const size_t, uint32_t*);
+typedef size_t (*DecodeIncrementsFunc)(const uint32_t*, const size_t, const unsigned int, const int64_t, const DecimalScale, const bool, double*, uint8_t*);
+
+struct Kernels {
+    UnpackBitsFunc unpack_bits{unpack_bits_scalar};
+    DecodeIncrementsFunc decode_increments{decode_increments_scalar};
+    const char* name{"scalar"};
+};
+
+static const Kernels& kernels()
+{
+    static const Kernels k = []() {
+        Kernels selected;
+#if defined(DBUFR_AVX2_DISPATCH)
+        if (cpu_has_avx2()) {
+            selected.unpack_bits = unpack_bits_avx2;
+            selected.decode_increments = decode_increments_avx2;
+            selected.name = "avx2";
+        }
+#endif
+        return selected;
+    }();
+    return k;
+}
+
+void unpack_bits(const uint8_t* data, const size_t bit_pos, const unsigned int bits,
+                 const size_t n, uint32_t* out)
+{
+    kernels().unpack_bits(data, bit_pos, bits, n, out);
+}
+
+size_t decode_increments(const uint32_t* increments, const size_t n, const unsigned int bits,
+                         const int64_t base, const DecimalScale scale, const bool check_missing,
+                         double* values, uint8_t* missing)
+{
+    return kernels().decode_increments(increments, n, bits, base, scale, check_missing, values, missing);
+}
+
+const char* bitunpack_implementation()
+{
+    return kernels().name;
+}
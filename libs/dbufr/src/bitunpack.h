@@ -0,0 +1,45 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "decimalscale.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Bulk kernels for compressed data. Each has a scalar version and, on x86 with
+// GCC or Clang, an AVX2 version selected at run time.
+
+// Unpack n fields of 'bits' bits (1 to 32) starting at bit_pos of data.
+// The 8 octets starting at the octet of every field must be readable.
+void unpack_bits(const uint8_t* data, const size_t bit_pos, const unsigned int bits,
+                 const size_t n, uint32_t* out);
+
+// values[i] = scale.apply(base + increments[i]), where base is R0 plus the reference value.
+// If check_missing, increments with all 'bits' bits set are missing: missing[i] = 1.
+// Returns the number of missing values.
+size_t decode_increments(const uint32_t* increments, const size_t n, const unsigned int bits,
+                         const int64_t base, const DecimalScale scale, const bool check_missing,
+                         double* values, uint8_t* missing);
+
+// Name of the selected implementation, "avx2" or "scalar".
+const char* bitunpack_implementation();
@@ -25,6 +25,10 @@
 #include <bitset>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
 
 static const std::array<unsigned int, 33> bitmask = {
     0U,
@@ -61,6 +65,26 @@ static const std::array<unsigned int, 33> bitmask = {
     0x7fffffffU,
     0xffffffffU};
 
+// 8 bytes big-endian load, p does not need to be aligned
+inline uint64_t load_be64(const unsigned char* p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__GNUC__) || defined(__clang__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+#elif defined(_MSC_VER)
+    v = _byteswap_uint64(v);
+#else
+    v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+#endif
+    return v;
+}
+
 // 4 bytes conversion
 inline int C4INT(const unsigned char* buf)
 {
@@ -0,0 +1,38 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrcolumns.h"
+
+#include "decimalscale.h"
+
+double BUFRColumn::value(const size_t subset) const
+{
+    return DecimalScale(scale).apply((double)mantissa(subset));
+}
+
+void BUFRColumn::values(std::vector<double>& out, const double missing_value) const
+{
+    const DecimalScale decimal_scale(scale);
+    out.resize(raw.size());
+    for (size_t n = 0; n < raw.size(); n++) {
+        out[n] = is_missing(n) ? missing_value : decimal_scale.apply((double)mantissa(n));
+    }
+}
@@ -0,0 +1,220 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrdataset.h"
+
+#include "bufrgzipsource.h"
+#include "bufrindex.h"
+#include "bufrsource.h"
+#include "bufrtables.h"
+#include "string_utils.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#ifndef _MSC_VER
+#include <dirent.h>
+#endif
+
+class BUFRDataset::PrivateData
+{
+public:
+    struct File {
+        std::string filename;
+        std::shared_ptr<BUFRSource> source;
+        // only for files starting with table messages
+        std::unique_ptr<BUFRTables> tables;
+    };
+
+    std::vector<File> files;
+
+    // global message index
+    std::vector<unsigned int> file_id;
+    std::vector<size_t> offset;
+    std::vector<size_t> length;
+
+    // database tables, shared by all files
+    std::map<TableVersions, std::unique_ptr<BUFRTables>> shared_tables;
+
+    std::mutex mutex;
+    std::atomic<unsigned int> next_message{0};
+};
+
+BUFRDataset::BUFRDataset(const std::vector<std::string>& filenames, const BUFRFileOptions& options)
+    : d(new PrivateData)
+{
+    d->files.resize(filenames.size());
+
+    for (size_t n = 0; n < filenames.size(); n++) {
+        PrivateData::File& file = d->files[n];
+        file.filename = filenames[n];
+        file.source = open_bufr_source(file.filename);
+
+        std::vector<size_t> offset;
+        std::vector<size_t> length;
+        std::vector<BUFRIndexEntry> index_entries;
+        find_messages(file.filename, *file.source, options.scan_threads, offset, length, index_entries);
+
+        d->file_id.insert(d->file_id.end(), offset.size(), (unsigned int)n);
+        d->offset.insert(d->offset.end(), offset.begin(), offset.end());
+        d->length.insert(d->length.end(), length.begin(), length.end());
+
+        if (offset.empty()) {
+            continue;
+        }
+
+        BUFRMessage bm;
+        bm.parse(file.source, offset[0], length[0]);
+        if (bm.data_cat() != 11) {
+            continue;
+        }
+
+        // load all data_cat==11 messages
+        file.tables.reset(new BUFRTables);
+        if (file.tables->load_table_message(bm)) {
+            for (size_t i = 1; i < offset.size(); i++) {
+                BUFRMessage table_bm;
+                table_bm.parse(file.source, offset[i], length[i]);
+                if (!file.tables->load_table_message(table_bm)) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+BUFRDataset::~BUFRDataset() = default;
+
+// index files written next to data files, and their temporaries while they are saved
+static bool is_index_file(const std::string& name)
+{
+    for (const std::string& suffix : {BUFRIndex::index_filename(""), GzipFileSource::index_filename("")}) {
+        if (ends_with(name, suffix) || ends_with(name, suffix + ".tmp")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> BUFRDataset::list_directory(const std::string& directory)
+{
+    std::vector<std::string> filenames;
+#ifndef _MSC_VER
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        throw std::runtime_error(fmt::format("Error opening directory: {}", directory));
+    }
+    while (auto const* f = readdir(dir)) {
+        const std::string name(f->d_name);
+        if (name[0] == '.') {
+            continue;
+        }
+        if (is_index_file(name)) {
+            continue;
+        }
+        const std::string filename = directory + "/" + name;
+        struct stat st {};
+        if (stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            filenames.push_back(filename);
+        }
+    }
+    closedir(dir);
+#else
+    throw std::runtime_error(fmt::format("BUFRDataset::list_directory is not supported on this platform: {}", directory));
+#endif
+    std::sort(filenames.begin(), filenames.end());
+    return filenames;
+}
+
+unsigned int BUFRDataset::num_files() const
+{
+    return (unsigned int)d->files.size();
+}
+
+const std::string& BUFRDataset::filename(const unsigned int file_id) const
+{
+    return d->files.at(file_id).filename;
+}
+
+unsigned int BUFRDataset::num_messages() const
+{
+    return (unsigned int)d->offset.size();
+}
+
+unsigned int BUFRDataset::file_id(const unsigned int message_num) const
+{
+    return d->file_id.at(message_num - 1);
+}
+
+size_t BUFRDataset::file_offset(const unsigned int message_num) const
+{
+    return d->offset.at(message_num - 1);
+}
+
+BUFRMessage BUFRDataset::get_message_num(const unsigned int message_num) const
+{
+    const unsigned int actual_message_num = message_num - 1;
+
+    if (actual_message_num >= d->offset.size()) {
+        throw std::runtime_error(fmt::format(" Incorrect message number {} actual_message_number {}", message_num, actual_message_num));
+    }
+
+    const PrivateData::File& file = d->files[d->file_id[actual_message_num]];
+
+    BUFRMessage bm;
+    bm.parse(file.source, d->offset[actual_message_num], d->length[actual_message_num]);
+
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    BUFRTables* tables = file.tables.get();
+    if (tables == nullptr) {
+        std::unique_ptr<BUFRTables>& shared = d->shared_tables[BUFRTables::versions_of(bm)];
+        if (!shared) {
+            shared.reset(new BUFRTables);
+        }
+        tables = shared.get();
+    }
+    tables->set_tables_for(bm);
+
+    return bm;
+}
+
+bool BUFRDataset::next_message_num(unsigned int& message_num)
+{
+    const unsigned int n = d->next_message.fetch_add(1);
+    if (n >= d->offset.size()) {
+        return false;
+    }
+    message_num = n + 1;
+    return true;
+}
+
+void BUFRDataset::rewind()
+{
+    d->next_message = 0;
+}
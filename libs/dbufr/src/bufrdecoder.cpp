@@ -23,7 +23,11 @@
 
 #include "bitreader.h"
 #include "bitutils.h"
+#include "bufrcolumns.h"
+#include "bufrsource.h"
 #include "bufrutil.h"
+#include "decimalscale.h"
+#include "decodeprogram.h"
 #include "fxy.h"
 #include "string_utils.h"
 #include "tablea.h"
@@ -33,28 +37,71 @@
 
 #include "fmt/format.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <cmath>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 
 static const FXY fxy_031021 = FXY(0, 31, 21);
 
+// uncompressed subsets decoded by one thread at least
+static const unsigned int min_subsets_per_thread = 32;
+
+// compressed messages with fewer subsets are unpacked while they are read
+static const unsigned int min_deferred_subsets = 256;
+
+// usually enough for sections 0 to 3 and the length of section 4
+static const size_t header_read_size = 512;
+
 void BUFRDecoder::parse(std::ifstream& ifile, const std::ios::pos_type file_offset)
 {
     size_t len_bufr;
     const std::ios::pos_type pos = seek_bufr(ifile, file_offset, len_bufr);
 
-    m_start_pos = file_offset;
-    m_end_pos = file_offset + static_cast<std::ios::pos_type>(len_bufr);
+    assert(!m_buffer);
+
+    reserve_owned_buffer(len_bufr, 0);
+    m_buffer = m_owned_buffer;
 
+    read_bufr(ifile, pos, len_bufr, m_owned_buffer);
+
+    m_buffer_length = len_bufr;
+
+    parse_buffer(pos, len_bufr);
+}
+
+void BUFRDecoder::parse(const std::shared_ptr<BUFRSource>& source, const size_t file_offset, const size_t len_bufr)
+{
     assert(!m_buffer);
 
-    m_buffer = new unsigned char[len_bufr];
+    if (file_offset + len_bufr > source->size()) {
+        throw std::runtime_error("BUFRDecoder::parse message goes past the end of the file");
+    }
+
+    // keep the source alive as long as this decoder, m_buffer may point into it
+    m_source = source;
+    m_source_offset = file_offset;
+    m_source_length = len_bufr;
+
+    if (source->data() != nullptr) {
+        m_buffer = source->data() + file_offset;
+        m_buffer_length = len_bufr;
+    } else {
+        read_from_source(std::min(len_bufr, header_read_size));
+    }
+
+    parse_buffer((size_t)source->origin() + file_offset, len_bufr);
+}
 
-    read_bufr(ifile, pos, len_bufr, m_buffer);
+void BUFRDecoder::parse_buffer(const size_t file_offset, const size_t len_bufr)
+{
+    m_start_pos = file_offset;
+    m_end_pos = file_offset + len_bufr;
 
     m_number_of_data_subsets = 0;
     m_number_of_data_values = 0;
@@ -82,13 +129,150 @@ void BUFRDecoder::parse(std::ifstream& ifile, const std::ios::pos_type file_offs
     decode_section_5();
 }
 
+// Read the first len octets of the message from the source, octets already read are kept.
+void BUFRDecoder::read_from_source(const size_t len)
+{
+    const size_t have = m_buffer == m_owned_buffer ? m_buffer_length : 0;
+    reserve_owned_buffer(len, have);
+    m_buffer = m_owned_buffer;
+    m_buffer_length = have;
+
+    m_source->read(m_source_offset + have, len - have, m_owned_buffer + have);
+    m_buffer_length = len;
+}
+
+// Room for len octets and the guard octets, which are zeroed. The first keep octets are preserved.
+// The buffer only grows, the following messages of a reused decoder (see reset) are read into it.
+void BUFRDecoder::reserve_owned_buffer(const size_t len, const size_t keep)
+{
+    const size_t capacity = len + bitreader_guard_octets;
+    if (capacity > m_owned_capacity) {
+        auto* buffer = new uint8_t[capacity];
+        std::copy(m_owned_buffer, m_owned_buffer + keep, buffer);
+        delete[] m_owned_buffer;
+        m_owned_buffer = buffer;
+        m_owned_capacity = capacity;
+    }
+    std::fill(m_owned_buffer + len, m_owned_buffer + capacity, 0);
+}
+
+// Make sure the first len octets of the message are in m_buffer.
+void BUFRDecoder::require(const size_t len)
+{
+    if (len <= m_buffer_length) {
+        return;
+    }
+    if (!m_source || len > m_source_length) {
+        throw std::runtime_error("BUFRDecoder: section goes past the end of the message");
+    }
+    read_from_source(std::min(std::max(len, 2 * m_buffer_length), m_source_length));
+}
+
+void BUFRDecoder::load_section_4()
+{
+    require(m_sec5_offset);
+}
+
+// Octets of m_buffer starting at offset that BitReader may load.
+size_t BUFRDecoder::readable_octets(const size_t offset) const
+{
+    if (m_buffer == m_owned_buffer) {
+        return m_buffer_length + bitreader_guard_octets - offset;
+    }
+    // memory mapped, everything up to the end of the file
+    return m_source->size() - m_source_offset - offset;
+}
+
+// Drops everything of the parsed message, the decoder can then parse another one. The owned buffer
+// and the containers keep their capacity, the decode program is kept for the next message with the
+// same data descriptors. Projection and decode threads are settings and stay as they are.
+void BUFRDecoder::reset()
+{
+    m_message_length = 0;
+    m_edition = 0;
+
+    m_master_table_number = 0;
+    m_originating_center = 0;
+    m_originating_subcenter = 0;
+    m_update_sequence = 0;
+    m_optional_sec_present = false;
+    m_data_cat = 0;
+    m_data_int_subcat = 0;
+    m_data_loc_subcat = 0;
+    m_master_table_version = 0;
+    m_local_table_version = 0;
+    m_year = 0;
+    m_month = 0;
+    m_day = 0;
+    m_hour = 0;
+    m_minute = 0;
+    m_second = 0;
+
+    m_number_of_data_subsets = 0;
+    m_flag_observed = false;
+    m_flag_compressed = false;
+    m_num_data_descriptors = 0;
+    m_data_descriptor_list.clear();
+
+    m_buffer = nullptr;
+    m_buffer_length = 0;
+    m_source.reset();
+    m_source_offset = 0;
+    m_source_length = 0;
+    std::fill(m_sec5, m_sec5 + 4, 0);
+
+    m_sec0_offset = 0;
+    m_sec1_offset = 0;
+    m_sec2_offset = 0;
+    m_sec3_offset = 0;
+    m_sec4_offset = 0;
+    m_sec5_offset = 0;
+
+    m_sec0_length = 0;
+    m_sec1_length = 0;
+    m_sec2_length = 0;
+    m_sec3_length = 0;
+    m_sec4_length = 0;
+    m_sec5_length = 0;
+
+    m_tablea = nullptr;
+    m_tableb = nullptr;
+    m_tabled = nullptr;
+    m_tablef = nullptr;
+    m_writable_tablea = nullptr;
+    m_writable_tableb = nullptr;
+    m_writable_tabled = nullptr;
+
+    reset_subset_state();
+    m_loaded_b_descriptors.clear();
+    m_program_loaded = false;
+
+    m_projection_active = false;
+    m_columns = nullptr;
+    m_column_subset = 0;
+    m_column_index = 0;
+    m_bitmap.clear();
+    m_defer_increments = false;
+    m_deferred_increments.clear();
+
+    m_start_pos = 0;
+    m_end_pos = 0;
+    m_number_of_data_values = 0;
+    m_cur_data_value = 0;
+
+    m_subset_nodes.clear();
+    m_decoded = false;
+    m_code_meaning.clear();
+}
+
 BUFRDecoder::~BUFRDecoder()
 {
     m_tablea = nullptr;
     m_tableb = nullptr;
     m_tabled = nullptr;
 
-    delete[] m_buffer;
+    delete[] m_owned_buffer;
+    m_owned_buffer = nullptr;
     m_buffer = nullptr;
 }
 
@@ -101,10 +285,28 @@ void BUFRDecoder::set_tables(TableA* const tablea,
     m_tableb = tableb;
     m_tabled = tabled;
     m_tablef = tablef;
+    m_writable_tablea = tablea;
+    m_writable_tableb = tableb;
+    m_writable_tabled = tabled;
+}
+
+void BUFRDecoder::set_shared_tables(const TableA* const tablea,
+                                    const TableB* const tableb,
+                                    const TableD* const tabled,
+                                    const TableF* const tablef)
+{
+    m_tablea = tablea;
+    m_tableb = tableb;
+    m_tabled = tabled;
+    m_tablef = tablef;
+    m_writable_tablea = nullptr;
+    m_writable_tableb = nullptr;
+    m_writable_tabled = nullptr;
 }
 
 void BUFRDecoder::parse_sections()
 {
+    require(8);
     if (m_buffer[0] != 'B' || m_buffer[1] != 'U' || m_buffer[2] != 'F' || m_buffer[3] != 'R') {
         throw std::runtime_error("BUFRMessage::parse_sections() BUFR string is not at the beginning of m_buffer");
     }
@@ -120,6 +322,7 @@ void BUFRDecoder::parse_sections()
     if (m_sec1_offset >= m_message_length) {
         throw std::runtime_error("BUFRMessage::parse_sections() m_sec1_offset > m_message_length");
     }
+    require(m_sec1_offset + 3);
     m_sec1_length = C3UINT(m_buffer + m_sec1_offset);
     DEBUGLN("m_sec1_offset = " << m_sec1_offset << " m_sec1_length = " << m_sec1_length);
 
@@ -127,6 +330,7 @@ void BUFRDecoder::parse_sections()
     if (m_sec2_offset >= m_message_length) {
         throw std::runtime_error("BUFRMessage::parse_sections() m_sec2_offset > m_message_length");
     }
+    require(m_sec2_offset + 3);
     m_sec2_length = 0;
     if (m_edition == 3 && C1INT(m_buffer + m_sec1_offset + 7) != 0) {
         m_sec2_length = C3UINT(m_buffer + m_sec2_offset);
@@ -140,6 +344,7 @@ void BUFRDecoder::parse_sections()
     if (m_sec3_offset >= m_message_length) {
         throw std::runtime_error("BUFRMessage::parse_sections() m_sec3_offset > m_message_length");
     }
+    require(m_sec3_offset + 3);
     m_sec3_length = C3UINT(m_buffer + m_sec3_offset);
     DEBUGLN("m_sec3_offset = " << m_sec3_offset << " m_sec3_length = " << m_sec3_length);
 
@@ -147,6 +352,7 @@ void BUFRDecoder::parse_sections()
     if (m_sec4_offset >= m_message_length) {
         throw std::runtime_error("BUFRMessage::parse_sections() m_sec4_offset > m_message_length");
     }
+    require(m_sec4_offset + 3);
     m_sec4_length = C3UINT(m_buffer + m_sec4_offset);
     DEBUGLN("m_sec4_offset = " << m_sec4_offset << " m_sec4_length = " << m_sec4_length);
 
@@ -161,7 +367,13 @@ void BUFRDecoder::parse_sections()
         throw std::runtime_error("Error in BUFRMessage::parse_sections() : message_length != len(0+1+2+3+4+5)");
     }
 
-    if (m_buffer[m_sec5_offset + 0] != '7' || m_buffer[m_sec5_offset + 1] != '7' || m_buffer[m_sec5_offset + 2] != '7' || m_buffer[m_sec5_offset + 3] != '7') {
+    if (m_sec5_offset + m_sec5_length <= m_buffer_length) {
+        std::copy(m_buffer + m_sec5_offset, m_buffer + m_sec5_offset + m_sec5_length, m_sec5);
+    } else {
+        m_source->read(m_source_offset + m_sec5_offset, m_sec5_length, m_sec5);
+    }
+
+    if (m_sec5[0] != '7' || m_sec5[1] != '7' || m_sec5[2] != '7' || m_sec5[3] != '7') {
         throw std::runtime_error("BUFRMessage::parse_sections() 7777 string is not at the end of m_buffer");
     }
 }
@@ -327,56 +539,850 @@ void BUFRDecoder::decode_section_4(NodeItem* const nodeitem)
     }
 
     if (!m_decoded) {
+        load_section_4();
+        prepare_projection(true);
+
         const uint8_t* const sec4 = m_buffer + m_sec4_offset;
 
         // skip 4 octets at the beginning of section (length)
-        BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8);
+        BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable_octets(m_sec4_offset + 4));
+
+        const unsigned int num_of_subset = m_flag_compressed ? 1 : m_number_of_data_subsets;
+
+        // nullptr for lists that change the tables, those are decoded recursively
+        const DecodeProgram* const program = decode_program();
+
+        const unsigned int threads = subset_threads(program);
+        std::vector<size_t> offsets;
+        if (threads > 1 && find_subset_offsets(*program, br, offsets)) {
+            // subset nodes are added here, their subtrees by the threads, each in its own arena
+            const std::vector<unsigned int> ranges = subset_ranges(0, threads, 1);
+            for (size_t r = 0; r + 1 < ranges.size(); r++) {
+                NodeArena* const arena = nodeitem->add_arena();
+                for (unsigned int n = ranges[r]; n < ranges[r + 1]; n++) {
+                    NodeItem* subset_nodeitem = nodeitem->add_child(arena);
+                    subset_nodeitem->data().set_name(fmt::format("Subset: {}", n + 1));
+                    subset_nodeitem->data().set_description("");
+                    m_subset_nodes.push_back(subset_nodeitem);
+                }
+            }
+            decode_subsets_parallel(offsets, ranges, [&](BUFRDecoder& worker, const unsigned int n, BitReader& subset_br) {
+                worker.run_decode_program(program->ops, 0, program->ops.size(), 1, subset_br, 0, m_subset_nodes[n]);
+            });
+            br.set_pos(offsets.back());
+        } else {
+            // stale increments of a decoding that threw are dropped
+            m_defer_increments = compressed_threads(program) > 1;
+            m_deferred_increments.clear();
+
+            for (unsigned int n = 0; n < num_of_subset; n++) {
+
+                reset_subset_state();
+
+                if (m_flag_compressed) {
+                    if (program) {
+                        run_decode_program(program->ops, 0, program->ops.size(), 1, br, 0, nodeitem);
+                    } else {
+                        read_descriptor_list(m_data_descriptor_list, 1, br, 0, nodeitem);
+                    }
+                    m_subset_nodes.push_back(nodeitem);
+                } else {
+                    NodeItem* subset_nodeitem = nodeitem->add_child();
+                    Item& subset_item = subset_nodeitem->data();
+                    std::stringstream ostr;
+                    ostr << "Subset: " << n + 1;
+                    subset_item.set_name(ostr.str());
+                    subset_item.set_description("");
+
+                    if (program) {
+                        run_decode_program(program->ops, 0, program->ops.size(), 1, br, 0, subset_nodeitem);
+                    } else {
+                        read_descriptor_list(m_data_descriptor_list, 1, br, 0, subset_nodeitem);
+                    }
+                    m_subset_nodes.push_back(subset_nodeitem);
+                }
+            }
+            unpack_deferred_increments();
+        }
+
+        assert(32 + br.get_pos() + br.get_remaining_bits() == m_sec4_length * 8);
+        assert(m_subset_nodes.size() == num_of_subset);
+
+        collect_code_flags(nodeitem);
+        m_tablef->populate_code_flags(m_code_meaning, m_loaded_b_descriptors);
+        build_code_flags(nodeitem);
+
+        m_decoded = true;
+    }
+}
+
+// 94.5.3.9 If a BUFR message is made up of more than one subset,
+//          each subset shall be treated as though it was the first subset encountered.
+void BUFRDecoder::reset_subset_state()
+{
+    m_new_data_width = 0;
+    m_new_scale = 0;
+    m_new_refval_bits = 0;
+    m_signify_data_width = 0;
+    m_assocaited_field_bits = 0;
+    m_increase_scale_ref_width = 0;
+    m_new_ccitt_width = 0;
+
+    m_new_reference_values.clear();
+
+    m_construction_of_bitmap = false;
+    m_current_bitmap_index = 0;
+    m_backward_reference = -1; // undefined
+    m_expanded_descriptors_for_bitmap.clear();
+}
+
+void BUFRDecoder::decode_columns(BUFRColumns& columns)
+{
+    columns.clear();
+    columns.number_of_subsets = m_number_of_data_subsets;
+
+    if (m_number_of_data_subsets == 0) {
+        return;
+    }
+
+    const DecodeProgram* const program = decode_program();
+    if (program == nullptr) {
+        throw std::runtime_error("BUFRDecoder::decode_columns: the data descriptors can not be compiled, decode the message to a tree");
+    }
+
+    load_section_4();
+    prepare_projection(false);
+
+    const uint8_t* const sec4 = m_buffer + m_sec4_offset;
+    BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable_octets(m_sec4_offset + 4));
+
+    const unsigned int num_of_subset = m_flag_compressed ? 1 : m_number_of_data_subsets;
+
+    const unsigned int threads = subset_threads(program);
+
+    m_columns = &columns;
+    try {
+        std::vector<size_t> offsets;
+        if (threads > 1 && find_subset_offsets(*program, br, offsets)) {
+            // the first subset creates the columns, the threads fill in the other subsets.
+            // Missing bits of 64 subsets share a word, the ranges start at multiples of 64.
+            br.set_pos(offsets[0]);
+            reset_subset_state();
+            decode_column_subset(*program, 0, br);
+            decode_subsets_parallel(offsets, subset_ranges(1, threads, 64), [&](BUFRDecoder& worker, const unsigned int n, BitReader& subset_br) {
+                worker.decode_column_subset(*program, n, subset_br);
+            });
+        } else {
+            m_defer_increments = compressed_threads(program) > 1;
+            for (unsigned int n = 0; n < num_of_subset; n++) {
+                reset_subset_state();
+                decode_column_subset(*program, n, br);
+            }
+            unpack_deferred_increments();
+        }
+    } catch (...) {
+        m_deferred_increments.clear();
+        m_columns = nullptr;
+        throw;
+    }
+    m_columns = nullptr;
+}
+
+void BUFRDecoder::decode_column_subset(const DecodeProgram& program, const unsigned int subset, BitReader& br)
+{
+    m_column_subset = subset;
+    m_column_index = 0;
+
+    run_decode_program_columns(program.ops, 0, program.ops.size(), 1, br);
+
+    if (m_column_index != m_columns->columns.size()) {
+        throw std::runtime_error(fmt::format("BUFRDecoder::decode_columns: subset {} has {} elements, the first subset has {}",
+                                             subset + 1, m_column_index, m_columns->columns.size()));
+    }
+}
+
+unsigned int BUFRDecoder::decode_threads() const
+{
+    const unsigned int threads = m_decode_threads > 0 ? m_decode_threads : std::thread::hardware_concurrency();
+    return std::max(threads, 1U);
+}
+
+// Uncompressed subsets start wherever the previous subset ended. Messages with many subsets
+// are decoded in two passes: the first one only skips through the subsets and records their
+// offsets, then ranges of subsets are decoded by separate threads, each with its own decoder.
+// Every subset starts from the initial operator state (94.5.3.9), so nothing else is carried
+// over from the previous subset.
+unsigned int BUFRDecoder::subset_threads(const DecodeProgram* const program) const
+{
+    if (program == nullptr || m_flag_compressed) {
+        return 1;
+    }
+    // few subsets per thread are not worth the first pass
+    return std::max(std::min(decode_threads(), m_number_of_data_subsets / min_subsets_per_thread), 1U);
+}
+
+// offsets[n] is the bit position of subset n, the last offset is the end of the last subset.
+// Returns false if the subsets can not be skipped, they are then decoded one after another
+// so that the error is reported where it occurs.
+bool BUFRDecoder::find_subset_offsets(const DecodeProgram& program, BitReader& br, std::vector<size_t>& offsets)
+{
+    const size_t start = br.get_pos();
+    offsets.resize(m_number_of_data_subsets + 1);
+
+    m_skip_pass = true;
+    try {
+        for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
+            reset_subset_state();
+            offsets[n] = br.get_pos();
+            run_skip_program(program.ops, 0, program.ops.size(), 1, br);
+        }
+    } catch (const std::exception&) {
+        m_skip_pass = false;
+        br.set_pos(start);
+        return false;
+    }
+    m_skip_pass = false;
+    offsets[m_number_of_data_subsets] = br.get_pos();
+    return true;
+}
+
+// Same as run_decode_program, only the bit position, the replication factors and the
+// state of operators and bit-maps are kept. Elements are skipped by their width unless
+// their value is needed (data present bit-map, new reference values).
+void BUFRDecoder::run_skip_program(const std::vector<DecodeOp>& ops,
+                                   const size_t first,
+                                   const size_t last,
+                                   const unsigned int iterations,
+                                   BitReader& br)
+{
+    for (unsigned int iter = 0; iter < iterations; iter++) {
+
+        size_t i = first;
+        while (i < last) {
+            const DecodeOp& op = ops[i];
+
+            switch (op.kind) {
+            case DecodeOp::Kind::Element:
+                if (!skip_element(op.fxy, br)) {
+                    read_element_descriptor(op.fxy, br, m_skip_item, 0);
+                }
+                break;
+            case DecodeOp::Kind::Replication:
+            case DecodeOp::Kind::DelayedReplication: {
+                const bool delayed = op.kind == DecodeOp::Kind::DelayedReplication;
+                const unsigned int niter = delayed ? read_delayed_replication_factor(op.fxy_next, br) : op.fxy.y();
+
+                if (m_construction_of_bitmap) {
+                    m_bitmap.clear();
+                }
+
+                run_skip_program(ops, i + 1, op.next, niter, br);
+
+                if (m_construction_of_bitmap) {
+                    // end of data present bit-map construction
+                    assert(m_bitmap.size() == niter);
+                    m_construction_of_bitmap = false;
+                }
+                break;
+            }
+            case DecodeOp::Kind::Operator:
+                read_operator_descriptor(op.fxy, op.fxy_next, br, m_skip_item, nullptr, 0);
+                break;
+            case DecodeOp::Kind::Sequence:
+                run_skip_program(ops, i + 1, op.next, 1, br);
+                break;
+            case DecodeOp::Kind::DRP: {
+                std::string sequence_str;
+                const unsigned int niter = read_drp_factor(op.fxy, br, sequence_str);
+                if (niter > 0) {
+                    run_skip_program(ops, i + 1, op.next, niter, br);
+                }
+                break;
+            }
+            }
+
+            i = op.next;
+        }
+    }
+}
+
+// Splits subsets first .. m_number_of_data_subsets - 1 into at most threads ranges,
+// range r is ranges[r] .. ranges[r + 1] - 1. Ranges other than the first start at multiples of align.
+std::vector<unsigned int> BUFRDecoder::subset_ranges(const unsigned int first, const unsigned int threads, const unsigned int align) const
+{
+    const unsigned int size = (m_number_of_data_subsets - first + threads - 1) / threads;
+
+    std::vector<unsigned int> ranges{first};
+    for (unsigned int r = 1; r < threads; r++) {
+        const unsigned int start = (first + r * size + align - 1) / align * align;
+        if (start > ranges.back() && start < m_number_of_data_subsets) {
+            ranges.push_back(start);
+        }
+    }
+    ranges.push_back(m_number_of_data_subsets);
+    return ranges;
+}
+
+// Second pass, decode_subset is called for every subset of ranges with the worker decoder of
+// its range and a bit reader at the offset of the subset. The first range is decoded by the
+// calling thread. Errors are rethrown after all threads are done, the first subset first.
+void BUFRDecoder::decode_subsets_parallel(const std::vector<size_t>& offsets,
+                                          const std::vector<unsigned int>& ranges,
+                                          const std::function<void(BUFRDecoder&, const unsigned int, BitReader&)>& decode_subset)
+{
+    const size_t num_ranges = ranges.size() - 1;
+
+    std::vector<std::unique_ptr<BUFRDecoder>> workers(num_ranges);
+    for (auto& worker : workers) {
+        worker.reset(new BUFRDecoder);
+        worker->init_subset_worker(*this);
+    }
+    std::vector<std::exception_ptr> errors(num_ranges);
+
+    const uint8_t* const sec4 = m_buffer + m_sec4_offset;
+    const size_t readable = readable_octets(m_sec4_offset + 4);
+
+    auto decode_range = [&](const size_t r) {
+        try {
+            BUFRDecoder& worker = *workers[r];
+            BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable);
+            for (unsigned int n = ranges[r]; n < ranges[r + 1]; n++) {
+                worker.reset_subset_state();
+                br.set_pos(offsets[n]);
+                decode_subset(worker, n, br);
+                if (br.get_pos() != offsets[n + 1]) {
+                    throw std::runtime_error(fmt::format("BUFRDecoder: subset {} ends at bit {}, the first pass found {}",
+                                                         n + 1, br.get_pos(), offsets[n + 1]));
+                }
+            }
+        } catch (...) {
+            errors[r] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_ranges - 1);
+    for (size_t r = 1; r < num_ranges; r++) {
+        threads.emplace_back(decode_range, r);
+    }
+    decode_range(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t r = 0; r < num_ranges; r++) {
+        if (errors[r]) {
+            std::rethrow_exception(errors[r]);
+        }
+        // the last value of an element wins, as if the subsets were decoded in order
+        for (const auto& loaded : workers[r]->m_loaded_b_descriptors) {
+            m_loaded_b_descriptors[loaded.first] = loaded.second;
+        }
+    }
+}
+
+// Everything the subsets of message are decoded with. Tables are only read.
+void BUFRDecoder::init_subset_worker(const BUFRDecoder& message)
+{
+    m_tablea = message.m_tablea;
+    m_tableb = message.m_tableb;
+    m_tabled = message.m_tabled;
+    m_tablef = message.m_tablef;
+
+    m_data_cat = message.m_data_cat;
+    m_number_of_data_subsets = message.m_number_of_data_subsets;
+    m_flag_compressed = message.m_flag_compressed;
+
+    m_projection_active = message.m_projection_active;
+    m_projection = message.m_projection;
+
+    m_columns = message.m_columns;
+}
+
+// Same as run_decode_program, elements are written to m_columns
+void BUFRDecoder::run_decode_program_columns(const std::vector<DecodeOp>& ops,
+                                             const size_t first,
+                                             const size_t last,
+                                             const unsigned int iterations,
+                                             BitReader& br)
+{
+    for (unsigned int iter = 0; iter < iterations; iter++) {
+
+        size_t i = first;
+        while (i < last) {
+            const DecodeOp& op = ops[i];
+
+            switch (op.kind) {
+            case DecodeOp::Kind::Element:
+                if (!skip_element(op.fxy, br)) {
+                    read_element_column(op.fxy, br);
+                }
+                break;
+            case DecodeOp::Kind::Replication:
+            case DecodeOp::Kind::DelayedReplication: {
+                const bool delayed = op.kind == DecodeOp::Kind::DelayedReplication;
+                unsigned int niter = op.fxy.y();
+                if (delayed) {
+                    niter = read_delayed_replication_factor(op.fxy_next, br);
+                    const int y_next = op.fxy_next.y();
+                    const int factor_bits = y_next == 0 ? 1 : (y_next == 1 ? 8 : 16);
+                    BUFRColumn& column = next_column(op.fxy_next, false, 0, 0, factor_bits);
+                    if (m_flag_compressed) {
+                        column.raw.assign(m_number_of_data_subsets, niter);
+                    } else {
+                        column.raw[m_column_subset] = niter;
+                    }
+                }
+
+                if (m_construction_of_bitmap) {
+                    m_bitmap.clear();
+                }
+
+                const unsigned int count = replicated_body_count(delayed, br);
+                for (unsigned int n = 0; n < count; n++) {
+                    run_decode_program_columns(ops, i + 1, op.next, niter, br);
+                }
+
+                if (m_construction_of_bitmap) {
+                    // end of data present bit-map construction
+                    assert(m_bitmap.size() == niter);
+                    m_construction_of_bitmap = false;
+                }
+                break;
+            }
+            case DecodeOp::Kind::Operator: {
+                Item item;
+                read_operator_descriptor(op.fxy, op.fxy_next, br, item, nullptr, 0);
+                if (op.fxy.x() == 5) {
+                    // 2 05 YYY character data
+                    BUFRColumn& column = next_column(op.fxy, true, 0, 0, op.fxy.y() * 8);
+                    if (m_flag_compressed) {
+                        column.strings.assign(m_number_of_data_subsets, item.values[0].s);
+                    } else {
+                        column.strings[m_column_subset] = item.values[0].s;
+                    }
+                }
+                break;
+            }
+            case DecodeOp::Kind::Sequence:
+                run_decode_program_columns(ops, i + 1, op.next, 1, br);
+                break;
+            case DecodeOp::Kind::DRP: {
+                std::string sequence_str;
+                const unsigned int niter = read_drp_factor(op.fxy, br, sequence_str);
+                if (niter > 0) {
+                    const unsigned int count = replicated_body_count(true, br);
+                    for (unsigned int n = 0; n < count; n++) {
+                        run_decode_program_columns(ops, i + 1, op.next, niter, br);
+                    }
+                }
+                break;
+            }
+            }
+
+            i = op.next;
+        }
+    }
+}
+
+void BUFRDecoder::set_projection(const std::vector<uint16_t>& descriptors, const std::vector<std::string>& mnemonics)
+{
+    m_projection_descriptors = descriptors;
+    m_projection_mnemonics = mnemonics;
+}
+
+void BUFRDecoder::set_decode_threads(const unsigned int threads)
+{
+    m_decode_threads = threads;
+}
+
+// Elements selected by the projection, mnemonics are looked up in the tables of this message.
+// With code_flag_conditions the elements that conditional code and flag tables of selected
+// elements depend on are decoded too, their values select the meanings (populate_code_flags).
+void BUFRDecoder::prepare_projection(const bool code_flag_conditions)
+{
+    m_projection_active = !m_projection_descriptors.empty() || !m_projection_mnemonics.empty();
+    if (!m_projection_active) {
+        return;
+    }
+
+    std::vector<FXY> selected;
+    for (const uint16_t d : m_projection_descriptors) {
+        selected.emplace_back(d);
+    }
+    for (const std::string& mnemonic : m_projection_mnemonics) {
+        FXY fxy(0);
+        if (m_tableb->search_mnemonic(mnemonic, fxy)) {
+            selected.push_back(fxy);
+        }
+    }
+
+    m_projection.assign(65536, false);
+    std::vector<FXY> conditions;
+    for (const FXY fxy : selected) {
+        m_projection[fxy.as_int()] = true;
+        if (code_flag_conditions && m_tablef != nullptr && m_tableb->exists_decriptor(fxy)) {
+            const DescriptorTableB& desc = m_tableb->get_decriptor(fxy);
+            if (desc.is_code() || desc.is_flag()) {
+                m_tablef->get_condition_descriptors(fxy, conditions);
+            }
+        }
+    }
+    for (const FXY fxy : conditions) {
+        m_projection[fxy.as_int()] = true;
+    }
+}
+
+// Skips an element that is not selected by the projection, or any element in the first pass
+// of the parallel decoding (find_subset_offsets), only its width is computed.
+// Returns false if the element must be decoded: it is selected, there is no projection,
+// or its value is needed (data present bit-map, new reference values).
+bool BUFRDecoder::skip_element(const FXY fxy, BitReader& br, const bool bit_width_plus_one)
+{
+    if (!m_skip_pass && (!m_projection_active || m_projection[fxy.as_int()])) {
+        return false;
+    }
+    if (m_construction_of_bitmap) {
+        return false;
+    }
+    if (m_new_refval_bits > 0 && m_new_refval_bits != 255) {
+        return false;
+    }
+
+    const DescriptorTableB& desc = m_tableb->get_decriptor(fxy);
+
+    m_expanded_descriptors_for_bitmap.push_back(fxy);
+
+    const bool compressed = m_flag_compressed;
+
+    if (!desc.is_numeric_data()) { // character element
+
+        // Apply operator 2 04 YYY (character)
+        if (m_assocaited_field_bits > 0 && fxy != fxy_031021) {
+            br.get_int(m_assocaited_field_bits);
+        }
+
+        // Apply operator 2 08 YYY
+        const int char_bit_width = m_new_ccitt_width > 0 ? m_new_ccitt_width : desc.bit_width();
+        br.skip_bits(char_bit_width);
+
+        if (compressed) {
+            const unsigned int octets = br.get_int(6);
+            br.skip_bits(octets * 8 * m_number_of_data_subsets);
+        }
+        return true;
+    }
+
+    // Apply operator 2 04 YYY (non-character)
+    if (m_assocaited_field_bits > 0 && fxy != fxy_031021) {
+        br.get_int(m_assocaited_field_bits);
+        if (compressed) {
+            const unsigned int bits = br.get_int(6);
+            if (bits > 0) {
+                check_increments(br, bits);
+                br.skip_bits(bits * m_number_of_data_subsets);
+            }
+        }
+    }
+
+    ElementEncoding encoding = element_encoding(desc, bit_width_plus_one);
+    apply_reference_operators(desc, encoding);
+
+    // Apply operator 2 06 YYY
+    int bit_width = encoding.bit_width;
+    if (m_signify_data_width > 0) {
+        bit_width = m_signify_data_width;
+        m_signify_data_width = 0;
+    }
+
+    const int64_t enc_value = br.get_int(bit_width);
+
+    if (compressed) {
+        const unsigned int bits = br.get_int(6);
+        if (bits > 0) {
+            if (is_all_ones_64(enc_value, bit_width)) {
+                throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor:\nNumber bits for increments must be 0 for missing data. It is {}.\nDescriptor {}", bits, fxy.as_str()));
+            }
+            check_increments(br, bits);
+            br.skip_bits(bits * m_number_of_data_subsets);
+        }
+    }
+    return true;
+}
+
+// Column of the next element. Columns are created by the first subset, the
+// following subsets must have the same elements with the same encoding.
+BUFRColumn& BUFRDecoder::next_column(const FXY fxy, const bool is_string, const int scale, const int reference, const int bits)
+{
+    std::vector<BUFRColumn>& columns = m_columns->columns;
+    const size_t index = m_column_index++;
+
+    if (m_column_subset == 0) {
+        columns.emplace_back();
+        BUFRColumn& column = columns.back();
+        column.fxy = fxy.as_int();
+        column.is_string = is_string;
+        column.scale = scale;
+        column.reference = reference;
+        column.bits = bits;
+        if (is_string) {
+            column.strings.resize(m_number_of_data_subsets);
+        } else {
+            column.raw.resize(m_number_of_data_subsets);
+        }
+        column.missing.resize((m_number_of_data_subsets + 63) / 64);
+        return column;
+    }
+
+    if (index >= columns.size()) {
+        throw std::runtime_error(fmt::format("BUFRDecoder::decode_columns: subset {} has more elements than the first subset", m_column_subset + 1));
+    }
+    BUFRColumn& column = columns[index];
+    if (column.fxy != fxy.as_int() || column.is_string != is_string || column.scale != scale || column.reference != reference || column.bits != bits) {
+        throw std::runtime_error(fmt::format("BUFRDecoder::decode_columns: element {} ({}) of subset {} differs from the first subset",
+                                             index, fxy.as_str(), m_column_subset + 1));
+    }
+    return column;
+}
+
+// Same as read_element_descriptor, the encoded values are written to the next column
+void BUFRDecoder::read_element_column(const FXY fxy, BitReader& br, const bool bit_width_plus_one)
+{
+    if (fxy.f() != 0) {
+        throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor: not an element descriptor {}", fxy.as_str()));
+    }
+
+    if (m_construction_of_bitmap) {
+        // during the bit-map construction all elements
+        // must be the element descriptor for the data present indicator (031031)
+        assert(fxy == FXY(0, 31, 31));
+    }
+
+    const DescriptorTableB& desc = m_tableb->get_decriptor(fxy);
+
+    m_expanded_descriptors_for_bitmap.push_back(fxy);
+
+    const size_t nsubsets = m_number_of_data_subsets;
+
+    if (!desc.is_numeric_data()) { // character element
+
+        // Apply operator 2 04 YYY (character)
+        if (m_assocaited_field_bits > 0 && fxy != fxy_031021) {
+            br.get_int(m_assocaited_field_bits);
+        }
+
+        // Apply operator 2 08 YYY
+        const int char_bit_width = m_new_ccitt_width > 0 ? m_new_ccitt_width : desc.bit_width();
+
+        const std::string char_element = br.get_string(char_bit_width);
+        BUFRColumn& column = next_column(fxy, true, 0, 0, char_bit_width);
+
+        if (m_flag_compressed) {
+            const unsigned int octets = br.get_int(6);
+            if (octets > 0) {
+                CompressedIncrements increments;
+                increments.column = (size_t)(&column - m_columns->columns.data());
+                increments.pos = br.get_pos();
+                increments.bits = octets * 8;
+                increments.is_string = true;
+                if (!defer_increments(increments, br)) {
+                    unpack_increments(increments, br, m_increment_buffers);
+                }
+            } else {
+                column.strings.assign(nsubsets, char_element);
+            }
+        } else {
+            column.strings[m_column_subset] = char_element;
+        }
+        return;
+    }
+
+    // Apply operator 2 04 YYY (non-character)
+    if (m_assocaited_field_bits > 0 && fxy != fxy_031021) {
+        br.get_int(m_assocaited_field_bits);
+        if (m_flag_compressed) {
+            const unsigned int bits = br.get_int(6);
+            if (bits > 0) {
+                check_increments(br, bits);
+                br.skip_bits(bits * m_number_of_data_subsets);
+            }
+        }
+    }
+
+    ElementEncoding encoding = element_encoding(desc, bit_width_plus_one);
+
+    // Apply operator 2 03 YYY, the element is a new reference value, not stored in a column
+    if (m_new_refval_bits > 0 && m_new_refval_bits != 255) {
+        int new_ref = br.get_int(m_new_refval_bits);
+        const int top_bit_mask = 1U << (m_new_refval_bits - 1);
+        if ((new_ref & top_bit_mask) != 0) {
+            new_ref = -(new_ref & ~top_bit_mask);
+        }
+        m_new_reference_values[desc.fxy()] = new_ref;
+        return;
+    }
+
+    apply_reference_operators(desc, encoding);
+
+    // Apply operator 2 06 YYY
+    int bit_width = encoding.bit_width;
+    if (m_signify_data_width > 0) {
+        bit_width = m_signify_data_width;
+        m_signify_data_width = 0;
+    }
+
+    const int64_t enc_value = br.get_int(bit_width);
+    const bool all_ones = is_all_ones_64(enc_value, bit_width);
+
+    BUFRColumn& column = next_column(fxy, false, encoding.scale, encoding.reference, bit_width);
+    const DecimalScale decimal_scale(encoding.scale);
+
+    if (m_flag_compressed) {
+        const unsigned int bits = br.get_int(6);
+
+        if (bits > 0 && all_ones) {
+            throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor:\nNumber bits for increments must be 0 for missing data. It is {}.\nDescriptor {}", bits, fxy.as_str()));
+        }
+
+        if (all_ones) {
+            column.raw.assign(nsubsets, enc_value);
+            for (size_t n = 0; n < nsubsets; n++) {
+                column.set_missing(n);
+            }
+            if (m_construction_of_bitmap) {
+                assert(bit_width == 1);
+                m_bitmap.push_back((int)enc_value);
+            }
+        } else if (bits == 0) {
+            column.raw.assign(nsubsets, enc_value);
+            if (m_construction_of_bitmap) {
+                m_bitmap.push_back((int)decimal_scale.apply((double)(enc_value + encoding.reference)));
+            }
+        } else {
+            check_increments(br, bits);
+            CompressedIncrements increments;
+            increments.column = (size_t)(&column - m_columns->columns.data());
+            increments.pos = br.get_pos();
+            increments.bits = bits;
+            increments.base = enc_value;
+            increments.check_missing = bit_width > 1;
+            if (!defer_increments(increments, br)) {
+                unpack_increments(increments, br, m_increment_buffers);
+                if (m_construction_of_bitmap) {
+                    for (size_t n = 0; n < nsubsets; n++) {
+                        if (!column.is_missing(n)) {
+                            m_bitmap.push_back((int)decimal_scale.apply((double)column.mantissa(n)));
+                        }
+                    }
+                }
+            }
+        }
+    } else {
+        column.raw[m_column_subset] = enc_value;
+        if (all_ones) {
+            column.set_missing(m_column_subset);
+            if (m_construction_of_bitmap) {
+                assert(bit_width == 1);
+                m_bitmap.push_back((int)enc_value);
+            }
+        } else if (m_construction_of_bitmap) {
+            m_bitmap.push_back((int)decimal_scale.apply((double)(enc_value + encoding.reference)));
+        }
+    }
+}
+
+const DecodeProgram* BUFRDecoder::decode_program()
+{
+    if (!m_program_loaded) {
+        // the program of the previous message is kept by reset, consecutive messages
+        // usually have the same data descriptors and tables
+        const bool same_program = m_program_tabled_generation == m_tabled->generation() && m_program_tableb_generation == m_tableb->generation() && m_program_descriptors == m_data_descriptor_list;
+        if (!same_program) {
+            m_program = DecodeProgramCache::instance().get(m_data_descriptor_list, *m_tabled, *m_tableb);
+            m_program_descriptors = m_data_descriptor_list;
+            m_program_tabled_generation = m_tabled->generation();
+            m_program_tableb_generation = m_tableb->generation();
+        }
+        m_program_loaded = true;
+    }
+    return m_program.get();
+}
+
+bool BUFRDecoder::has_fixed_layout()
+{
+    if (m_flag_compressed || m_number_of_data_subsets == 0) {
+        return false;
+    }
+    const DecodeProgram* const program = decode_program();
+    if (program == nullptr || !program->fixed_layout) {
+        return false;
+    }
+    // subsets of a fixed layout are stored back to back, check the data section holds all of them
+    return program->subset_bits * m_number_of_data_subsets <= (m_sec4_length - 4) * 8;
+}
+
+std::vector<uint16_t> BUFRDecoder::layout_descriptors()
+{
+    std::vector<uint16_t> descriptors;
+    if (!has_fixed_layout()) {
+        return descriptors;
+    }
+    const DecodeProgram* const program = decode_program();
+    descriptors.reserve(program->layout.size());
+    for (const LayoutElement& element : program->layout) {
+        descriptors.push_back(element.fxy.as_int());
+    }
+    return descriptors;
+}
 
-        const unsigned int num_of_subset = m_flag_compressed ? 1 : m_number_of_data_subsets;
+void BUFRDecoder::read_layout_elements(const size_t element,
+                                       const unsigned int first_subset,
+                                       const unsigned int num_subsets,
+                                       std::vector<Item::Value>& values)
+{
+    if (!has_fixed_layout()) {
+        throw std::runtime_error("BUFRDecoder::read_layout_elements: message does not have a fixed layout");
+    }
+    const DecodeProgram* const program = decode_program();
+    if (element >= program->layout.size()) {
+        throw std::runtime_error(fmt::format("BUFRDecoder::read_layout_elements: element {} out of range, number of elements {}", element, program->layout.size()));
+    }
+    if (first_subset >= m_number_of_data_subsets || num_subsets > m_number_of_data_subsets - first_subset) {
+        throw std::runtime_error(fmt::format("BUFRDecoder::read_layout_elements: subsets {}-{} out of range, number of subsets {}",
+                                             first_subset + 1, first_subset + num_subsets, m_number_of_data_subsets));
+    }
 
-        for (unsigned int n = 0; n < num_of_subset; n++) {
+    load_section_4();
 
-            // 94.5.3.9 If a BUFR message is made up of more than one subset,
-            //          each subset shall be treated as though it was the first subset encountered.
-            m_new_data_width = 0;
-            m_new_scale = 0;
-            m_new_refval_bits = 0;
-            m_signify_data_width = 0;
-            m_assocaited_field_bits = 0;
-            m_increase_scale_ref_width = 0;
-            m_new_ccitt_width = 0;
+    const uint8_t* const sec4 = m_buffer + m_sec4_offset;
+    BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable_octets(m_sec4_offset + 4));
 
-            m_new_reference_values.clear();
+    const LayoutElement& layout_element = program->layout[element];
 
-            m_construction_of_bitmap = false;
-            m_current_bitmap_index = 0;
-            m_backward_reference = -1; // undefined
-            m_expanded_descriptors_for_bitmap.clear();
+    values.resize(num_subsets);
+    for (unsigned int n = 0; n < num_subsets; n++) {
+        br.set_pos((first_subset + n) * program->subset_bits + layout_element.offset);
 
-            if (m_flag_compressed) {
-                read_descriptor_list(m_data_descriptor_list, 1, br, 0, nodeitem);
-                m_subset_nodes.push_back(nodeitem);
-            } else {
-                NodeItem* subset_nodeitem = nodeitem->add_child();
-                Item& subset_item = subset_nodeitem->data();
-                std::stringstream ostr;
-                ostr << "Subset: " << n + 1;
-                subset_item.name = ostr.str();
-                subset_item.description = "";
-
-                read_descriptor_list(m_data_descriptor_list, 1, br, 0, subset_nodeitem);
-                m_subset_nodes.push_back(subset_nodeitem);
-            }
+        Item::Value& value = values[n];
+        if (layout_element.is_string) {
+            value.type = Item::ValueType::String;
+            value.s = br.get_string(layout_element.bits);
+            continue;
+        }
+        value.s.clear();
+        // has_fixed_layout checked that all subsets fit in section 4, numeric widths are 1 to 32 bits
+        const int64_t enc_value = br.get_int<BitCheck::Unchecked>(layout_element.bits);
+        if (is_all_ones_64(enc_value, layout_element.bits)) {
+            value.type = Item::ValueType::Missing;
+            value.d = 0.0;
+            value.mantissa = 0;
+            value.scale = 0;
+        } else {
+            value.type = Item::ValueType::Double;
+            value.mantissa = enc_value + layout_element.reference;
+            value.scale = layout_element.scale.scale();
+            value.d = layout_element.scale.apply((double)value.mantissa);
         }
-
-        assert(32 + br.get_pos() + br.get_remaining_bits() == m_sec4_length * 8);
-        assert(m_subset_nodes.size() == num_of_subset);
-
-        collect_code_flags(nodeitem);
-        m_tablef->populate_code_flags(m_code_meaning, m_loaded_b_descriptors);
-        build_code_flags(nodeitem);
-
-        m_decoded = true;
     }
 }
 
@@ -413,7 +1419,7 @@ void BUFRDecoder::dump_section_4(std::ostream& ostr) const
 
 void BUFRDecoder::decode_section_5()
 {
-    const uint8_t* const sec5 = m_buffer + m_sec5_offset;
+    const uint8_t* const sec5 = m_sec5;
     if (sec5[0] != '7' || sec5[1] != '7' || sec5[2] != '7' || sec5[3] != '7') {
         throw std::runtime_error("Can not find 7777");
     }
@@ -421,7 +1427,7 @@ void BUFRDecoder::decode_section_5()
 
 void BUFRDecoder::dump_section_5(std::ostream& ostr) const
 {
-    const uint8_t* const sec5 = m_buffer + m_sec5_offset;
+    const uint8_t* const sec5 = m_sec5;
 
     ostr << "Section 5 - End Section" << '\n';
     ostr << "---------" << '\n';
@@ -446,9 +1452,12 @@ void BUFRDecoder::read_descriptor_list(const std::vector<FXY>& descriptor_list,
             const FXY current_descriptor = descriptor_list[desc];
             const int f = current_descriptor.f();
 
-            const std::string fxy_s = current_descriptor.as_str();
+            if (f == 0 && skip_element(current_descriptor, br)) {
+                desc++;
+                continue;
+            }
 
-            DEBUG("[" << fxy_s << "]");
+            DEBUG("[" << current_descriptor.as_str() << "]");
             if (iterations > 1) { // iteration of replication
                 DEBUG("-r" << iter);
             }
@@ -458,12 +1467,10 @@ void BUFRDecoder::read_descriptor_list(const std::vector<FXY>& descriptor_list,
             NodeItem* descriptor_nodeitem = parent_nodeitem->add_child();
             Item& item = descriptor_nodeitem->data();
 
-            item.name = fxy_s;
-            if (iterations > 1) { // iteration of replication
-                item.name += fmt::format(" ({})", iter);
-            }
+            // the iteration of replication is part of the label
+            item.set_label(current_descriptor.as_int(), iterations > 1 ? static_cast<int>(iter) : -1);
 
-            DEBUG(ind << fxy_s << " ");
+            DEBUG(ind << current_descriptor.as_str() << " ");
 
             if (f == 0) { // element descriptor
                 item.type = Item::Type::Element;
@@ -508,6 +1515,258 @@ void BUFRDecoder::read_descriptor_list(const std::vector<FXY>& descriptor_list,
     }     // end of for iter
 }
 
+// Same as read_descriptor_list for ops [first, last) of a compiled descriptor list.
+void BUFRDecoder::run_decode_program(const std::vector<DecodeOp>& ops,
+                                     const size_t first,
+                                     const size_t last,
+                                     const unsigned int iterations,
+                                     BitReader& br,
+                                     const int indent,
+                                     NodeItem* parent_nodeitem)
+{
+    for (unsigned int iter = 0; iter < iterations; iter++) {
+
+        size_t i = first;
+        while (i < last) {
+            const DecodeOp& op = ops[i];
+
+            if (op.kind == DecodeOp::Kind::Element && skip_element(op.fxy, br)) {
+                i = op.next;
+                continue;
+            }
+
+            NodeItem* descriptor_nodeitem = parent_nodeitem->add_child();
+            Item& item = descriptor_nodeitem->data();
+
+            // the iteration of replication is part of the label
+            item.set_label(op.fxy.as_int(), iterations > 1 ? static_cast<int>(iter) : -1);
+
+            switch (op.kind) {
+            case DecodeOp::Kind::Element:
+                item.type = Item::Type::Element;
+                read_element_descriptor(op.fxy, br, item, indent);
+                break;
+            case DecodeOp::Kind::Replication:
+            case DecodeOp::Kind::DelayedReplication: {
+                item.type = Item::Type::Replicator;
+                const bool delayed = op.kind == DecodeOp::Kind::DelayedReplication;
+                const unsigned int niter = delayed ? read_delayed_replication_factor(op.fxy, op.fxy_next, br, parent_nodeitem, indent)
+                                                   : op.fxy.y();
+                item.set_description(fmt::format("delayed replication operator {} descriptors replicated ...", op.fxy.x()));
+
+                if (m_construction_of_bitmap) {
+                    m_bitmap.clear();
+                }
+
+                const unsigned int count = replicated_body_count(delayed, br);
+                for (unsigned int n = 0; n < count; n++) {
+                    run_decode_program(ops, i + 1, op.next, niter, br, indent, parent_nodeitem);
+                }
+
+                if (m_construction_of_bitmap) {
+                    // end of data present bit-map construction
+                    assert(m_bitmap.size() == niter);
+                    m_construction_of_bitmap = false;
+                }
+                break;
+            }
+            case DecodeOp::Kind::Operator:
+                item.type = Item::Type::Operator;
+                read_operator_descriptor(op.fxy, op.fxy_next, br, item, parent_nodeitem, indent);
+                break;
+            case DecodeOp::Kind::Sequence:
+                item.type = Item::Type::Sequence;
+                run_decode_program(ops, i + 1, op.next, 1, br, indent + 1, descriptor_nodeitem);
+                item.set_description(op.description);
+                break;
+            case DecodeOp::Kind::DRP: {
+                item.type = Item::Type::Sequence;
+                std::string sequence_str;
+                item.bits_range_start = br.get_pos();
+                const unsigned int niter = read_drp_factor(op.fxy, br, sequence_str);
+                item.bits_range_end = br.get_pos() - 1;
+
+                if (niter > 0) {
+                    const unsigned int count = replicated_body_count(true, br);
+                    for (unsigned int n = 0; n < count; n++) {
+                        run_decode_program(ops, i + 1, op.next, niter, br, indent, descriptor_nodeitem);
+                    }
+                }
+                item.set_description(sequence_str);
+                break;
+            }
+            }
+
+            i = op.next;
+        }
+    }
+}
+
+// Increments of all subsets (NBINC bits each) must be in section 4, they are then read unchecked.
+void BUFRDecoder::check_increments(const BitReader& br, const unsigned int bits) const
+{
+    if (bits > 32) {
+        throw std::runtime_error(fmt::format("BUFRDecoder: number of bits for increments {} > 32", bits));
+    }
+    if (!br.has_bits((size_t)bits * m_number_of_data_subsets)) {
+        throw std::runtime_error(fmt::format("BUFRDecoder: increments go past the end of section 4. cursor_position: {} bits: {} subsets: {}",
+                                             br.get_pos(), bits, m_number_of_data_subsets));
+    }
+}
+
+// All increments of a compressed element are unpacked and scaled in bulk, br is at the first one.
+// 94.6.3 (2)(ii) an increment with all bits set to 1 is a missing value. Not for 1 bit
+// elements (data present indicator, flags) where it is the only non-zero value.
+void BUFRDecoder::unpack_increments(const CompressedIncrements& increments, BitReader& br, IncrementBuffers& buffers) const
+{
+    const size_t nsubsets = m_number_of_data_subsets;
+    const unsigned int bits = increments.bits;
+
+    if (increments.is_string) {
+        if (increments.item != nullptr) {
+            std::vector<Item::Value>& values = increments.item->values;
+            values.resize(nsubsets);
+            for (size_t n = 0; n < nsubsets; n++) {
+                values[n].type = Item::ValueType::String;
+                values[n].s = br.get_string(bits);
+            }
+        } else {
+            std::vector<std::string>& strings = m_columns->columns[increments.column].strings;
+            for (size_t n = 0; n < nsubsets; n++) {
+                strings[n] = br.get_string(bits);
+            }
+        }
+        return;
+    }
+
+    buffers.increments.resize(nsubsets);
+    br.get_ints<BitCheck::Unchecked>(bits, nsubsets, buffers.increments.data());
+
+    if (increments.item == nullptr) {
+        BUFRColumn& column = m_columns->columns[increments.column];
+        const uint32_t missing_increment = (uint32_t)(0xffffffffULL >> (32 - bits));
+        for (size_t n = 0; n < nsubsets; n++) {
+            const uint32_t increment = buffers.increments[n];
+            column.raw[n] = (uint64_t)increments.base + increment;
+            if (increments.check_missing && increment == missing_increment) {
+                column.set_missing(n);
+            }
+        }
+        return;
+    }
+
+    buffers.values.resize(nsubsets);
+    buffers.missing.resize(nsubsets);
+    decode_increments(buffers.increments.data(), nsubsets, bits, increments.base, DecimalScale(increments.scale), increments.check_missing,
+                      buffers.values.data(), buffers.missing.data());
+
+    std::vector<Item::Value>& values = increments.item->values;
+    values.resize(nsubsets);
+    for (size_t n = 0; n < nsubsets; n++) {
+        Item::Value& value = values[n];
+        if (buffers.missing[n]) {
+            value.type = Item::ValueType::Missing;
+            continue;
+        }
+        value.type = Item::ValueType::Double;
+        value.d = buffers.values[n];
+        value.mantissa = increments.base + buffers.increments[n];
+        value.scale = increments.scale;
+    }
+}
+
+// Compressed elements are self-contained: R0, NBINC and then the increments of all subsets.
+// Elements of messages with many subsets are first only read up to NBINC and their increments
+// skipped, which finds where the increments of every element start. After the whole data section
+// is read the increments are unpacked element by element by several threads.
+unsigned int BUFRDecoder::compressed_threads(const DecodeProgram* const program) const
+{
+    // the tables defined in the data are decoded from the values of their elements
+    if (program == nullptr || !m_flag_compressed || m_number_of_data_subsets < min_deferred_subsets) {
+        return 1;
+    }
+    return decode_threads();
+}
+
+// Returns false if the increments must be unpacked now: the values are needed (data present bit-map),
+// or they go past the end of section 4 (the error is reported by unpack_increments).
+bool BUFRDecoder::defer_increments(const CompressedIncrements& increments, BitReader& br)
+{
+    if (!m_defer_increments || m_construction_of_bitmap) {
+        return false;
+    }
+    const size_t bits = (size_t)increments.bits * m_number_of_data_subsets;
+    if (!br.has_bits(bits)) {
+        return false;
+    }
+
+    if (increments.item != nullptr && !increments.is_string) {
+        // the first value is needed by read_element_descriptor (loaded Table B values)
+        const uint32_t increment = br.get_int(increments.bits);
+        Item::Value value;
+        if (increments.check_missing && increment == (uint32_t)(0xffffffffULL >> (32 - increments.bits))) {
+            value.type = Item::ValueType::Missing;
+        } else {
+            value.type = Item::ValueType::Double;
+            value.mantissa = increments.base + increment;
+            value.scale = increments.scale;
+            value.d = DecimalScale(increments.scale).apply((double)value.mantissa);
+        }
+        increments.item->values.assign(1, value);
+    }
+
+    m_deferred_increments.push_back(increments);
+    br.set_pos(increments.pos + bits);
+    return true;
+}
+
+void BUFRDecoder::unpack_deferred_increments()
+{
+    if (m_deferred_increments.empty()) {
+        return;
+    }
+
+    const size_t num_increments = m_deferred_increments.size();
+    const unsigned int num_threads = (unsigned int)std::min((size_t)decode_threads(), num_increments);
+
+    const uint8_t* const sec4 = m_buffer + m_sec4_offset;
+    const size_t readable = readable_octets(m_sec4_offset + 4);
+
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(num_threads);
+
+    auto unpack = [&](const unsigned int t) {
+        try {
+            IncrementBuffers buffers;
+            BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable);
+            for (size_t i = next++; i < num_increments; i = next++) {
+                const CompressedIncrements& increments = m_deferred_increments[i];
+                br.set_pos(increments.pos);
+                unpack_increments(increments, br, buffers);
+            }
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned int t = 1; t < num_threads; t++) {
+        threads.emplace_back(unpack, t);
+    }
+    unpack(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    m_deferred_increments.clear();
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
 void BUFRDecoder::read_element_descriptor(const FXY fxy,
                                           BitReader& br,
                                           Item& item,
@@ -533,16 +1792,12 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
     const DescriptorTableB& desc = m_tableb->get_decriptor(fxy);
 
     m_expanded_descriptors_for_bitmap.push_back(fxy);
-    if (m_backward_reference < 0) {
-        // add a label
-        item.name += fmt::format(" [{}]", m_expanded_descriptors_for_bitmap.size() - 1);
-    }
+
+    // the label index is only shown outside of bit-map references
+    const int expanded_index = m_backward_reference < 0 ? static_cast<int>(m_expanded_descriptors_for_bitmap.size() - 1) : -1;
 
     item.fxy = desc.fxy().as_int();
-    item.name = item.name + " " + desc.mnemonic();
-    item.mnemonic = desc.mnemonic();
-    item.unit = desc.unit();
-    item.description = desc.description();
+    item.set_element_info(desc.element_info(), expanded_index);
 
     item.bits_range_start = br.get_pos();
 
@@ -573,13 +1828,13 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
                     (void)c;
                     assert(c == '\0' || c == '0'); // NOTE: allow '0' in addition to '\0'. some messages are not following the standard
                 }
-                for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
-                    const std::string char_element_i = br.get_string(octets * 8);
-                    DEBUG(ind << desc.mnemonic() << " = " << std::setw(12) << char_element_i);
-                    Item::Value value;
-                    value.type = Item::ValueType::String;
-                    value.s = char_element_i;
-                    item.values.emplace_back(std::move(value));
+                CompressedIncrements increments;
+                increments.item = &item;
+                increments.pos = br.get_pos();
+                increments.bits = octets * 8;
+                increments.is_string = true;
+                if (!defer_increments(increments, br)) {
+                    unpack_increments(increments, br, m_increment_buffers);
                 }
             } else {
                 // 94.6.3 (2)(i) ... however, if the character data values in all subsets are identical,
@@ -612,47 +1867,20 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
             if (m_flag_compressed && m_number_of_data_subsets > 0) {
 
                 const unsigned int bits = br.get_int(6);
-                unsigned int increment = 0;
-                for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
-                    if (bits > 0) {
-                        increment = br.get_int(bits);
-                    }
+                if (bits > 0) {
+                    check_increments(br, bits);
+                    br.skip_bits(bits * m_number_of_data_subsets);
                 }
-                (void)increment; // NOT USED YET
             }
         }
 
-        int scale = desc.scale();
-        int reference = desc.reference();
-        int bit_width = desc.bit_width();
-
-        item.ref_value = reference;
-        item.scale = scale;
-        item.bits = bit_width;
-
-        if (desc.is_data()) {
-            // Apply operators 2 01 YYY and 2 02 YYY
-            scale += m_new_scale;
-            bit_width += m_new_data_width;
-            item.scale = scale;
-            item.bits = bit_width;
-            if (m_new_scale != 0) {
-                item.new_scale = true;
-            }
-            if (m_new_data_width != 0) {
-                item.new_bits = true;
-            }
+        ElementEncoding encoding = element_encoding(desc, bit_width_plus_one);
 
-            // Apply operator 2 25 255
-            // if the element is being read as part of "Difference statistical values marker operator"
-            // See BUFR_TableC
-            if (bit_width_plus_one) {
-                reference = -int_pow(2, bit_width);
-                bit_width++;
-                item.ref_value = reference;
-                item.bits = bit_width;
-            }
-        }
+        item.ref_value = encoding.reference;
+        item.scale = encoding.scale;
+        item.bits = encoding.bit_width;
+        item.new_scale = encoding.new_scale;
+        item.new_bits = encoding.new_bits;
 
         // Apply operator 2 03 YYY
         if (m_new_refval_bits > 0 && m_new_refval_bits != 255) {
@@ -677,13 +1905,14 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
             m_new_reference_values[desc.fxy()] = new_ref;
             DEBUG('\n');
 
-            item.description = fmt::format("reference value for this descriptor ({}) changed to {}", fxy.as_str(), new_ref);
+            item.set_description(fmt::format("reference value for this descriptor ({}) changed to {}", fxy.as_str(), new_ref));
 
             item.bits_range_end = br.get_pos() - 1;
 
             Item::Value value;
             value.type = Item::ValueType::Double;
             value.d = new_ref;
+            value.mantissa = new_ref;
             item.values.emplace_back(std::move(value));
 
             // add/repeat (m_number_of_data_subsets-1) values of new_ref, just to have the same
@@ -693,6 +1922,7 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
                     Item::Value value_additional;
                     value_additional.type = Item::ValueType::Double;
                     value_additional.d = new_ref;
+                    value_additional.mantissa = new_ref;
                     item.values.emplace_back(std::move(value_additional));
                 }
             }
@@ -700,43 +1930,22 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
             return; // RETURN RETURN
         }
 
-        if (m_new_refval_bits == 0 || m_new_refval_bits == 255) {
-            // end use of modified references
-        } else {
-            throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor: Unknown value for m_new_refval_bits {}", m_new_refval_bits));
-        }
-
-        if (m_new_reference_values.find(desc.fxy()) != m_new_reference_values.end()) {
-            reference = m_new_reference_values.at(desc.fxy());
-            item.new_ref_value = true;
-            item.ref_value = reference;
-        }
-
-        // Apply operator 2 07 YYY
-        if (m_increase_scale_ref_width > 0 && desc.is_data()) {
-            // 1. Add YYY to the existing scale factor
-            scale = scale + m_increase_scale_ref_width;
-            // 2. Multiply the existing reference value by 10^YYY
-            reference = reference * int_pow(10, m_increase_scale_ref_width);
-            // 3.  Calculate ((10 x YYY) + 2) ÷ 3, disregard any
-            //     fractional remainder and add the result to the
-            //     existing bit width.
-            const int add_bit_width = ((10 * m_increase_scale_ref_width) + 2) / 3;
-            bit_width = bit_width + add_bit_width;
+        apply_reference_operators(desc, encoding);
 
-            item.ref_value = reference;
-            item.scale = scale;
-            item.bits = bit_width;
-            item.new_ref_value = true;
-            item.new_scale = true;
-            item.new_bits = true;
-        }
+        item.ref_value = encoding.reference;
+        item.scale = encoding.scale;
+        item.bits = encoding.bit_width;
+        item.new_ref_value = encoding.new_ref_value;
+        item.new_scale = encoding.new_scale;
+        item.new_bits = encoding.new_bits;
 
         DEBUG(ind);
 
-        const double dscale = std::pow(10.0, -scale);
+        const int reference = encoding.reference;
+        const DecimalScale decimal_scale(encoding.scale);
 
         // Apply operator 2 06 YYY
+        int bit_width = encoding.bit_width;
         if (m_signify_data_width > 0) {
             bit_width = m_signify_data_width;
             m_signify_data_width = 0;
@@ -758,36 +1967,50 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
                 throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor:\nNumber bits for increments must be 0 for missing data. It is {}.\nDescriptor {}", bits, fxy.as_str()));
             }
 
-            for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
+            if (is_all_ones_64(enc_value, bit_width)) {
+                // 94.1.7  When a local reference value for a set of element values for compressed data is represented
+                //         as all bits set to 1, this shall imply that all values in the set are missing.
+                item.missing = true;
+                if (m_construction_of_bitmap) {
+                    assert(bit_width == 1);
+                    m_bitmap.push_back((int)enc_value);
+                }
+                DEBUG("MISSING ");
+            } else if (bits == 0) {
                 // If NBINC = 0, all values of element I are equal to R_0
                 // in such cases, the increments shell be omitted
-                unsigned int increment = 0;
-                if (bits > 0) {
-                    increment = br.get_int(bits);
+                Item::Value value;
+                value.type = Item::ValueType::Double;
+                value.mantissa = enc_value + reference;
+                value.scale = encoding.scale;
+                value.d = decimal_scale.apply((double)value.mantissa);
+                item.values.assign(m_number_of_data_subsets, value);
+                DEBUG(value.d << " ");
+                if (m_construction_of_bitmap) {
+                    // maybe we can use here enc_value. make sure reference is 0.
+                    m_bitmap.push_back((int)value.d);
                 }
-                // 94.1.7  When a local reference value for a set of element values for compressed data is represented
-                //         as all bits set to 1, this shall imply that all values in the set are missing.
-                if (is_all_ones_64(enc_value, bit_width)) {
-                    item.missing = true;
-                    if (m_construction_of_bitmap && (bits > 0 || n == 0)) {
-                        assert(bit_width == 1);
-                        m_bitmap.push_back((int)enc_value);
-                    }
-                    if (bits > 0 || n == 0) {
-                        DEBUG("MISSING ");
-                    }
-                } else {
-                    const double v = (enc_value + reference + increment) * dscale;
-                    Item::Value value;
-                    value.type = Item::ValueType::Double;
-                    value.d = v;
-                    item.values.emplace_back(std::move(value));
-                    if (bits > 0 || n == 0) {
-                        DEBUG(v << " ");
-                    }
-                    if (m_construction_of_bitmap && (bits > 0 || n == 0)) {
-                        // maybe we can use here enc_value. make sure reference is 0.
-                        m_bitmap.push_back((int)v);
+            } else {
+                // all increments are unpacked and scaled in bulk.
+                // 94.6.3 (2)(ii) an increment with all bits set to 1 is a missing value. Not for 1 bit
+                // elements (data present indicator, flags) where it is the only non-zero value.
+                check_increments(br, bits);
+                CompressedIncrements increments;
+                increments.item = &item;
+                increments.pos = br.get_pos();
+                increments.bits = bits;
+                increments.base = enc_value + reference;
+                increments.scale = encoding.scale;
+                increments.check_missing = bit_width > 1;
+                if (!defer_increments(increments, br)) {
+                    unpack_increments(increments, br, m_increment_buffers);
+                    if (m_construction_of_bitmap) {
+                        for (const Item::Value& value : item.values) {
+                            if (value.type != Item::ValueType::Missing) {
+                                // maybe we can use here enc_value. make sure reference is 0.
+                                m_bitmap.push_back((int)value.d);
+                            }
+                        }
                     }
                 }
             }
@@ -802,10 +2025,12 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
                 item.missing = true;
                 DEBUG("MISSING");
             } else {
-                const double v = (enc_value + reference) * dscale;
+                const double v = decimal_scale.apply((double)(enc_value + reference));
                 Item::Value value;
                 value.type = Item::ValueType::Double;
                 value.d = v;
+                value.mantissa = enc_value + reference;
+                value.scale = encoding.scale;
                 item.values.emplace_back(std::move(value));
                 if (m_construction_of_bitmap) {
                     // maybe we can use here enc_value. make sure reference is 0.
@@ -821,12 +2046,74 @@ void BUFRDecoder::read_element_descriptor(const FXY fxy,
     DEBUGLN(" " << desc.unit() << " " << desc.description());
 
     // save this (numeric) element in a map of already loaded elements
-    if (m_data_cat != 11 && !item.missing && desc.is_numeric_data()) {
+    if (m_data_cat != 11 && !item.is_missing() && desc.is_numeric_data()) {
         // always insert (overwrite)
         m_loaded_b_descriptors[desc.fxy()] = item.values[0].d;
     }
 }
 
+// Scale, reference value and data width of a numeric element after the operators
+// 2 01 YYY, 2 02 YYY and 2 25 255
+BUFRDecoder::ElementEncoding BUFRDecoder::element_encoding(const DescriptorTableB& desc, const bool bit_width_plus_one) const
+{
+    ElementEncoding encoding;
+    encoding.scale = desc.scale();
+    encoding.reference = desc.reference();
+    encoding.bit_width = desc.bit_width();
+
+    if (desc.is_data()) {
+        // Apply operators 2 01 YYY and 2 02 YYY
+        encoding.scale += m_new_scale;
+        encoding.bit_width += m_new_data_width;
+        encoding.new_scale = m_new_scale != 0;
+        encoding.new_bits = m_new_data_width != 0;
+
+        // Apply operator 2 25 255
+        // if the element is being read as part of "Difference statistical values marker operator"
+        // See BUFR_TableC
+        if (bit_width_plus_one) {
+            encoding.reference = -int_pow(2, encoding.bit_width);
+            encoding.bit_width++;
+        }
+    }
+    return encoding;
+}
+
+// Apply new reference values (2 03 YYY) and operator 2 07 YYY to the element encoding
+void BUFRDecoder::apply_reference_operators(const DescriptorTableB& desc, ElementEncoding& encoding) const
+{
+    if (m_new_refval_bits == 0 || m_new_refval_bits == 255) {
+        // end use of modified references
+    } else {
+        throw std::runtime_error(fmt::format("Error BUFRMessage::read_element_descriptor: Unknown value for m_new_refval_bits {}", m_new_refval_bits));
+    }
+
+    if (!m_new_reference_values.empty()) {
+        auto it = m_new_reference_values.find(desc.fxy());
+        if (it != m_new_reference_values.end()) {
+            encoding.reference = it->second;
+            encoding.new_ref_value = true;
+        }
+    }
+
+    // Apply operator 2 07 YYY
+    if (m_increase_scale_ref_width > 0 && desc.is_data()) {
+        // 1. Add YYY to the existing scale factor
+        encoding.scale = encoding.scale + m_increase_scale_ref_width;
+        // 2. Multiply the existing reference value by 10^YYY
+        encoding.reference = encoding.reference * int_pow(10, m_increase_scale_ref_width);
+        // 3.  Calculate ((10 x YYY) + 2) ÷ 3, disregard any
+        //     fractional remainder and add the result to the
+        //     existing bit width.
+        const int add_bit_width = ((10 * m_increase_scale_ref_width) + 2) / 3;
+        encoding.bit_width = encoding.bit_width + add_bit_width;
+
+        encoding.new_ref_value = true;
+        encoding.new_scale = true;
+        encoding.new_bits = true;
+    }
+}
+
 void BUFRDecoder::read_replication_descriptor(const FXY fxy,
                                               BitReader& br,
                                               Item& item,
@@ -845,69 +2132,15 @@ void BUFRDecoder::read_replication_descriptor(const FXY fxy,
 
         DEBUGLN(ind << fxy.as_str() << " delayed replication operator " << x << " descriptors replicated .... ");
 
-        const size_t desc_next = desc + 1;
-        const FXY next_desc = descriptor_list[desc_next];
-        int f_next;
-        int x_next;
-        int y_next;
-        next_desc.fxy(f_next, x_next, y_next);
-
-        NodeItem* delayed_nodeitem = parent_nodeitem->add_child();
-        Item& item_next = delayed_nodeitem->data();
-        item_next.name = next_desc.as_str();
-        item_next.type = Item::Type::Replicator;
-        item_next.bits_range_start = br.get_pos();
-
-        if (f_next != 0 || x_next != 31) {
-            throw std::runtime_error("the descriptor after the delayed replication operator is not 0 31 YYY");
-        }
-
-        std::string description_str;
-        if (y_next == 0) {
-            niter = br.get_int(1);
-            description_str = fmt::format("delayed (1-bit delay) replication operator {} descriptors replicated {} times", x, niter);
-        } else if (y_next == 1) {
-            niter = br.get_int(8);
-            description_str = fmt::format("delayed (8-bit delay) replication operator {} descriptors replicated {} times", x, niter);
-        } else if (y_next == 2) {
-            niter = br.get_int(16);
-            description_str = fmt::format("delayed (16-bit delay) replication operator {} descriptors replicated {} times", x, niter);
-        } else if (y_next == 11) {
-            // FIXME data_repetition_factor must be used to repeat that many times X (eks) data elements
-            const unsigned int data_repetition_factor = br.get_int(8);
-            std::cerr << next_desc.as_str() << " data_repetition_factor " << data_repetition_factor << " NOT USED YET" << '\n';
-            (void)data_repetition_factor; // NOT USED YET
-            assert(false);
-            niter = 1;
-        } else if (y_next == 12) {
-            // FIXME data_repetition_factor must be used to repeat that many times X (eks) data elements
-            const unsigned int data_repetition_factor = br.get_int(16);
-            (void)data_repetition_factor; // NOT USED YET
-            assert(false);
-            niter = 1;
-        } else {
-            throw std::runtime_error(fmt::format("Unknown delayed replication f, x, y ", f_next, x_next, y_next));
-        }
-
-        // See FM 94 BUFR - 94.5.5.3
-        // ... entities described by N element descriptors
-        // (including element descriptors for delayed replication, if present)
-        m_expanded_descriptors_for_bitmap.push_back(next_desc);
+        niter = read_delayed_replication_factor(fxy, descriptor_list[desc + 1], br, parent_nodeitem, indent);
 
         desc = desc + 1;
 
-        DEBUG("[" << next_desc.as_str() << "] ");
-        DEBUGLN(ind << next_desc.as_str() << " delayed replication operator " << x << " descriptors repeated " << niter << " times");
-
-        item_next.description = description_str;
-
-        item_next.bits_range_end = br.get_pos() - 1;
-
     } else {
         DEBUGLN(ind << fxy.as_str() << " standard replication operator " << x << " descriptors replicated " << y << " times");
     }
 
-    item.description = fmt::format("delayed replication operator {} descriptors replicated ...", x);
+    item.set_description(fmt::format("delayed replication operator {} descriptors replicated ...", x));
 
     // construct iter_list consisting of the next 'x' descriptors
     std::vector<FXY> iter_list;
@@ -928,16 +2161,8 @@ void BUFRDecoder::read_replication_descriptor(const FXY fxy,
         m_bitmap.clear(); // do we need to clear previously defined bitmap?
     }
 
-    if (m_flag_compressed && y == 0) {
-        const unsigned int bits = br.get_int(6);
-        if (bits > 0) {
-            for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
-                read_descriptor_list(iter_list, niter, br, indent, parent_nodeitem);
-            }
-        } else {
-            read_descriptor_list(iter_list, niter, br, indent, parent_nodeitem);
-        }
-    } else {
+    const unsigned int count = replicated_body_count(y == 0, br);
+    for (unsigned int n = 0; n < count; n++) {
         read_descriptor_list(iter_list, niter, br, indent, parent_nodeitem);
     }
 
@@ -948,6 +2173,101 @@ void BUFRDecoder::read_replication_descriptor(const FXY fxy,
     }
 }
 
+// Reads the delayed replication factor 0 31 YYY following the replication
+// operator fxy, the factor is added after the operator in parent_nodeitem.
+unsigned int BUFRDecoder::read_delayed_replication_factor(const FXY fxy,
+                                                          const FXY next_desc,
+                                                          BitReader& br,
+                                                          NodeItem* const parent_nodeitem,
+                                                          const int indent)
+{
+    const std::string ind(indent * 2, ' ');
+
+    const int x = fxy.x();
+
+    NodeItem* delayed_nodeitem = parent_nodeitem->add_child();
+    Item& item_next = delayed_nodeitem->data();
+    item_next.set_label(next_desc.as_int());
+    item_next.type = Item::Type::Replicator;
+    item_next.bits_range_start = br.get_pos();
+
+    const unsigned int niter = read_delayed_replication_factor(next_desc, br);
+
+    const int y_next = next_desc.y();
+    if (y_next == 0) {
+        item_next.set_description(fmt::format("delayed (1-bit delay) replication operator {} descriptors replicated {} times", x, niter));
+    } else if (y_next == 1) {
+        item_next.set_description(fmt::format("delayed (8-bit delay) replication operator {} descriptors replicated {} times", x, niter));
+    } else if (y_next == 2) {
+        item_next.set_description(fmt::format("delayed (16-bit delay) replication operator {} descriptors replicated {} times", x, niter));
+    }
+
+    DEBUG("[" << next_desc.as_str() << "] ");
+    DEBUGLN(ind << next_desc.as_str() << " delayed replication operator " << x << " descriptors repeated " << niter << " times");
+    (void)ind;
+
+    item_next.bits_range_end = br.get_pos() - 1;
+
+    return niter;
+}
+
+unsigned int BUFRDecoder::read_delayed_replication_factor(const FXY next_desc, BitReader& br)
+{
+    int f_next;
+    int x_next;
+    int y_next;
+    next_desc.fxy(f_next, x_next, y_next);
+
+    if (f_next != 0 || x_next != 31) {
+        throw std::runtime_error("the descriptor after the delayed replication operator is not 0 31 YYY");
+    }
+
+    unsigned int niter = 0;
+    if (y_next == 0) {
+        niter = br.get_int(1);
+    } else if (y_next == 1) {
+        niter = br.get_int(8);
+    } else if (y_next == 2) {
+        niter = br.get_int(16);
+    } else if (y_next == 11) {
+        // FIXME data_repetition_factor must be used to repeat that many times X (eks) data elements
+        const unsigned int data_repetition_factor = br.get_int(8);
+        std::cerr << next_desc.as_str() << " data_repetition_factor " << data_repetition_factor << " NOT USED YET" << '\n';
+        (void)data_repetition_factor; // NOT USED YET
+        assert(false);
+        niter = 1;
+    } else if (y_next == 12) {
+        // FIXME data_repetition_factor must be used to repeat that many times X (eks) data elements
+        const unsigned int data_repetition_factor = br.get_int(16);
+        (void)data_repetition_factor; // NOT USED YET
+        assert(false);
+        niter = 1;
+    } else {
+        throw std::runtime_error(fmt::format("Unknown delayed replication f, x, y ", f_next, x_next, y_next));
+    }
+
+    // See FM 94 BUFR - 94.5.5.3
+    // ... entities described by N element descriptors
+    // (including element descriptors for delayed replication, if present)
+    m_expanded_descriptors_for_bitmap.push_back(next_desc);
+
+    return niter;
+}
+
+// Number of times the replicated descriptors are stored. In compressed data the delayed
+// replication factor is followed by its NBINC, which must be 0 (same factor in all subsets).
+// Non-zero NBINC is decoded as if the descriptors were stored once per subset.
+unsigned int BUFRDecoder::replicated_body_count(const bool delayed, BitReader& br)
+{
+    if (m_flag_compressed && delayed) {
+        const unsigned int bits = br.get_int(6);
+        if (bits > 0) {
+            return m_number_of_data_subsets;
+        }
+    }
+    return 1;
+}
+
 void BUFRDecoder::read_operator_descriptor(const FXY fxy,
                                            const FXY fxy_next,
                                            BitReader& br,
@@ -1173,7 +2493,7 @@ void BUFRDecoder::read_operator_descriptor(const FXY fxy,
         throw std::runtime_error(fmt::format("Unsupported operator 2 {} {}", x, y));
     }
 
-    item.description = operator_str;
+    item.set_description(operator_str);
 }
 
 void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
@@ -1204,7 +2524,7 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         Item& f_item = descriptor_nodeitem->add_child()->data();
         const FXY f_fxy(0, 0, 10);
         f_item.fxy = f_fxy.as_int();
-        f_item.name = f_fxy.as_str();
+        f_item.set_label(f_fxy.as_int());
         f_item.type = Item::Type::Element;
         read_element_descriptor(f_fxy, br, f_item, indent);
         const int desc_d_f = string_to_int(f_item.as_string());
@@ -1212,7 +2532,7 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         Item& x_item = descriptor_nodeitem->add_child()->data();
         const FXY x_fxy(0, 0, 11);
         x_item.fxy = x_fxy.as_int();
-        x_item.name = x_fxy.as_str();
+        x_item.set_label(x_fxy.as_int());
         x_item.type = Item::Type::Element;
         read_element_descriptor(x_fxy, br, x_item, indent);
         const int desc_d_x = string_to_int(x_item.as_string());
@@ -1220,7 +2540,7 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         Item& y_item = descriptor_nodeitem->add_child()->data();
         const FXY y_fxy(0, 0, 12);
         y_item.fxy = y_fxy.as_int();
-        y_item.name = y_fxy.as_str();
+        y_item.set_label(y_fxy.as_int());
         y_item.type = Item::Type::Element;
         read_element_descriptor(y_fxy, br, y_item, indent);
         const int desc_d_y = string_to_int(y_item.as_string());
@@ -1243,7 +2563,7 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
             Item& oper_item = descriptor_nodeitem->add_child()->data();
             const FXY oper_fxy(f_next, x_next, y_next);
             oper_item.fxy = oper_fxy.as_int();
-            oper_item.name = oper_fxy.as_str();
+            oper_item.set_label(oper_fxy.as_int());
             oper_item.type = Item::Type::Operator;
             read_operator_descriptor(oper_fxy, FXY(0), br, oper_item, nullptr, indent);
 
@@ -1259,9 +2579,9 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
 
         Item& iterator_item = descriptor_nodeitem->add_child()->data();
         iterator_item.fxy = FXY(f_next, x_next, y_next).as_int();
-        iterator_item.name = FXY(f_next, x_next, y_next).as_str();
+        iterator_item.set_label(FXY(f_next, x_next, y_next).as_int());
         iterator_item.type = Item::Type::Replicator;
-        iterator_item.description = fmt::format("delayed replication operator {} descriptors replicated ...", x_next);
+        iterator_item.set_description(fmt::format("delayed replication operator {} descriptors replicated ...", x_next));
 
         desc++; // this next descriptor should be 0_31_YYY
         descriptor_list[desc].fxy(f_next, x_next, y_next);
@@ -1271,15 +2591,15 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         }
 
         Item& rep_item = descriptor_nodeitem->add_child()->data();
-        rep_item.name = FXY(f_next, x_next, y_next).as_str();
+        rep_item.set_label(FXY(f_next, x_next, y_next).as_int());
         rep_item.type = Item::Type::Replicator;
         rep_item.bits_range_start = br.get_pos();
         if (y_next == 1) {
             nchild = br.get_int(8);
-            rep_item.description = fmt::format("delayed (8-bit delay) replication operator {} descriptors replicated {} times", 1, nchild);
+            rep_item.set_description(fmt::format("delayed (8-bit delay) replication operator {} descriptors replicated {} times", 1, nchild));
         } else if (y_next == 2) {
             nchild = br.get_int(16);
-            rep_item.description = fmt::format("delayed (16-bit delay) replication operator {} descriptors replicated {} times", 1, nchild);
+            rep_item.set_description(fmt::format("delayed (16-bit delay) replication operator {} descriptors replicated {} times", 1, nchild));
         } else {
             throw std::runtime_error("didn't find delayed replicator 0_31_YYY YYY=1 or YYY=2");
         }
@@ -1296,7 +2616,7 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
 
             Item& child_item = descriptor_nodeitem->add_child()->data();
             child_item.fxy = sub_fxy.as_int();
-            child_item.name = sub_fxy.as_str();
+            child_item.set_label(sub_fxy.as_int());
             child_item.type = Item::Type::Element;
             read_element_descriptor(sub_fxy, br, child_item, indent);
             const std::string s_fxy = child_item.as_string();
@@ -1305,14 +2625,16 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         }
         DEBUGLN(" finished reading  [" << nchild << "]");
 
-        m_tabled->add_descriptor(desc_d);
+        if (m_writable_tabled != nullptr) {
+            m_writable_tabled->add_descriptor(desc_d);
+        }
 
     } else if (x == 0 && y == 4) { // Table B entry
 
         auto read_table_b_entry = [&](FXY a_fxy) {
             Item& i = descriptor_nodeitem->add_child()->data();
             i.fxy = a_fxy.as_int();
-            i.name = a_fxy.as_str();
+            i.set_label(a_fxy.as_int());
             i.type = Item::Type::Element;
             read_element_descriptor(a_fxy, br, i, indent);
             return i.as_string();
@@ -1341,52 +2663,26 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         }
 
         const std::string description = line1 + line2;
-        if (m_originating_center == 7) {
-            m_tableb->add_descriptor(DescriptorTableB(f_elem, x_elem, y_elem, line1.substr(0, 8), trim(description.substr(9, 55)), units, scale, reference, width));
-        } else {
-            m_tableb->add_descriptor(DescriptorTableB(f_elem, x_elem, y_elem, "", trim(description), units, scale, reference, width));
+        if (m_writable_tableb != nullptr) { // shared tables are read-only, the entry is only decoded
+            if (m_originating_center == 7) {
+                m_writable_tableb->add_descriptor(DescriptorTableB(f_elem, x_elem, y_elem, line1.substr(0, 8), trim(description.substr(9, 55)), units, scale, reference, width));
+            } else {
+                m_writable_tableb->add_descriptor(DescriptorTableB(f_elem, x_elem, y_elem, "", trim(description), units, scale, reference, width));
+            }
         }
 
     } else if (x == 60 && (y == 1 || y == 2 || y == 3 || y == 4)) { // one of DRP* descriptors
 
         item.bits_range_start = br.get_pos();
-        int niter;
-        if (y == 1) {
-            niter = br.get_int(16);
-            sequence_str = fmt::format("DRP16BIT niter = {}", niter);
-            DEBUGLN(sequence_str);
-        } else if (y == 2) {
-            niter = br.get_int(8);
-            sequence_str = fmt::format("DRP8BIT niter = {}", niter);
-            DEBUGLN(sequence_str);
-        } else if (y == 3) {
-            niter = br.get_int(8);
-            sequence_str = fmt::format("DRPSTAK niter = {}", niter);
-            DEBUGLN(sequence_str);
-        } else if (y == 4) {
-            niter = br.get_int(1);
-            sequence_str = fmt::format("DRP1BIT niter = {}", niter);
-            DEBUGLN(sequence_str);
-        } else {
-            throw std::runtime_error("Unknown 3-60-YYY sequence - DRP* descriptor");
-        }
-
+        const unsigned int niter = read_drp_factor(fxy, br, sequence_str);
         item.bits_range_end = br.get_pos() - 1;
 
         if (niter > 0) {
             std::vector<FXY> iter_list;
             iter_list.push_back(descriptor_list[desc + 1]);
 
-            if (m_flag_compressed) {
-                const unsigned int bits = br.get_int(6);
-                if (bits > 0) {
-                    for (unsigned int n = 0; n < m_number_of_data_subsets; n++) {
-                        read_descriptor_list(iter_list, niter, br, indent, descriptor_nodeitem);
-                    }
-                } else {
-                    read_descriptor_list(iter_list, niter, br, indent, descriptor_nodeitem);
-                }
-            } else {
+            const unsigned int count = replicated_body_count(true, br);
+            for (unsigned int n = 0; n < count; n++) {
                 read_descriptor_list(iter_list, niter, br, indent, descriptor_nodeitem);
             }
         }
@@ -1409,7 +2705,33 @@ void BUFRDecoder::read_sequence_descriptor(const FXY fxy,
         read_descriptor_list(sub_sequence, 1, br, indent + 1, descriptor_nodeitem);
     }
 
-    item.description = sequence_str;
+    item.set_description(sequence_str);
+}
+
+// Reads the replication factor of one of the DRP* descriptors 3 60 001-004
+unsigned int BUFRDecoder::read_drp_factor(const FXY fxy, BitReader& br, std::string& sequence_str)
+{
+    const int y = fxy.y();
+
+    unsigned int niter;
+    if (y == 1) {
+        niter = br.get_int(16);
+        sequence_str = fmt::format("DRP16BIT niter = {}", niter);
+    } else if (y == 2) {
+        niter = br.get_int(8);
+        sequence_str = fmt::format("DRP8BIT niter = {}", niter);
+    } else if (y == 3) {
+        niter = br.get_int(8);
+        sequence_str = fmt::format("DRPSTAK niter = {}", niter);
+    } else if (y == 4) {
+        niter = br.get_int(1);
+        sequence_str = fmt::format("DRP1BIT niter = {}", niter);
+    } else {
+        throw std::runtime_error("Unknown 3-60-YYY sequence - DRP* descriptor");
+    }
+    DEBUGLN(sequence_str);
+
+    return niter;
 }
 
 int BUFRDecoder::get_next_bitmap_index()
@@ -1429,9 +2751,20 @@ void BUFRDecoder::read_next_bitmap_element(NodeItem* parent_nodeitem, BitReader&
     if (bm_index >= 0) {
         const size_t back_idx = m_backward_reference - m_bitmap.size() + bm_index;
         const FXY bm_desc = m_expanded_descriptors_for_bitmap[back_idx];
+        if (skip_element(bm_desc, br, bit_width_plus_one)) {
+            return;
+        }
+        if (m_skip_pass) {
+            read_element_descriptor(bm_desc, br, m_skip_item, indent, bit_width_plus_one);
+            return;
+        }
+        if (m_columns != nullptr) {
+            read_element_column(bm_desc, br, bit_width_plus_one);
+            return;
+        }
         NodeItem* bitmap_nodeitem = parent_nodeitem->add_child();
         Item& item_bm = bitmap_nodeitem->data();
-        item_bm.name = fmt::format("{} -> [{}]", bm_desc.as_str(), back_idx);
+        item_bm.set_bitmap_label(bm_desc.as_int(), static_cast<int>(back_idx));
         item_bm.type = Item::Type::Element;
         read_element_descriptor(bm_desc, br, item_bm, indent, bit_width_plus_one);
     }
@@ -1447,7 +2780,7 @@ void BUFRDecoder::collect_code_flags(NodeItem* ni)
 
         if (desc.is_code()) {
             // look up code/flag table if this descriptor is a code/flag
-            if (!item.missing) {
+            if (!item.is_missing()) {
                 assert(!item.values.empty());
                 assert(item.values[0].type == Item::ValueType::Double);
                 assert(item.values[0].d < INT_MAX);
@@ -1455,7 +2788,7 @@ void BUFRDecoder::collect_code_flags(NodeItem* ni)
                 m_code_meaning[f] = "";
             }
         } else if (desc.is_flag()) {
-            if (!item.missing) {
+            if (!item.is_missing()) {
                 assert(!item.values.empty());
                 assert(item.values[0].type == Item::ValueType::Double);
                 const int single_value = (int)item.values[0].d;
@@ -1492,7 +2825,7 @@ void BUFRDecoder::build_code_flags(NodeItem* ni)
 
         if (desc.is_code()) {
             // look up code/flag table if this descriptor is a code/flag
-            if (!item.missing) {
+            if (!item.is_missing()) {
                 assert(!item.values.empty());
                 assert(item.values[0].type == Item::ValueType::Double);
                 assert(item.values[0].d < INT_MAX);
@@ -1502,7 +2835,7 @@ void BUFRDecoder::build_code_flags(NodeItem* ni)
                 item.value_tooltip = "CODE is missing";
             }
         } else if (desc.is_flag()) {
-            if (!item.missing) {
+            if (!item.is_missing()) {
                 assert(!item.values.empty());
                 assert(item.values[0].type == Item::ValueType::Double);
                 const int single_value = (int)item.values[0].d;
@@ -1584,9 +2917,14 @@ void BUFRDecoder::update_data_values(NodeItem* ni, std::vector<std::vector<const
 
 int BUFRDecoder::load_tables()
 {
+    if (m_writable_tablea == nullptr) {
+        throw std::runtime_error("BUFRDecoder::load_tables: the tables are shared and read-only");
+    }
     if (m_data_cat == 11) {
+        load_section_4();
+
         const unsigned char* sec4 = m_buffer + m_sec4_offset;
-        BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8);
+        BitReader br(sec4 + 4, (m_sec4_length - 4) * 8, (m_sec4_offset + 4) * 8, readable_octets(m_sec4_offset + 4));
         if (m_number_of_data_subsets > 0) {
             if (m_originating_center == 7) {
                 read_table_a_ncep(m_data_descriptor_list, br);
@@ -1680,7 +3018,7 @@ void BUFRDecoder::read_table_a_ncep(std::vector<FXY>& descriptor_list, BitReader
         read_element_descriptor(descriptor_list[desc_idx], br, item_line2, 0);
         const std::string table_a_line2 = item_line2.as_string();
 
-        m_tablea->add_descriptor(DescriptorTableA(0, 0, 0, table_a_entry, table_a_line1 + table_a_line2));
+        m_writable_tablea->add_descriptor(DescriptorTableA(0, 0, 0, table_a_entry, table_a_line1 + table_a_line2));
     }
     // table A has been loaded now.
 
@@ -1732,7 +3070,7 @@ void BUFRDecoder::read_table_a_ecmwf(std::vector<FXY>& descriptor_list, BitReade
     read_element_descriptor(descriptor_list[desc_idx], br, item_line2, 0);
     const std::string table_a_line2 = item_line2.as_string();
 
-    m_tablea->add_descriptor(DescriptorTableA(0, 0, 0, table_a_entry, table_a_line1 + table_a_line2));
+    m_writable_tablea->add_descriptor(DescriptorTableA(0, 0, 0, table_a_entry, table_a_line1 + table_a_line2));
 
     Item item_rest;
     read_element_descriptor(descriptor_list[3], br, item_rest, 0);
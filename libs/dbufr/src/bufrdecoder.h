@@ -25,10 +25,19 @@
 #include "item.h"
 
 #include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 class BitReader;
+class BUFRColumn;
+class BUFRColumns;
+class BUFRSource;
+class DecodeProgram;
+struct DecodeOp;
+class DescriptorTableB;
 class TableA;
 class TableB;
 class TableD;
@@ -44,9 +53,33 @@ public:
                     TableB* const tableb,
                     TableD* const tabled,
                     TableF* const tablef);
+    void set_shared_tables(const TableA* const tablea,
+                           const TableB* const tableb,
+                           const TableD* const tabled,
+                           const TableF* const tablef);
+
+    // Parse another message with the same buffers, see BUFRMessage::reset
+    void reset();
 
     void decode_section_4(NodeItem* const nodeitem);
 
+    // Direct access to elements of messages with a fixed layout, see BUFRMessage
+    bool has_fixed_layout();
+    std::vector<uint16_t> layout_descriptors();
+    void read_layout_elements(const size_t element,
+                              const unsigned int first_subset,
+                              const unsigned int num_subsets,
+                              std::vector<Item::Value>& values);
+
+    // Section 4 without a tree, see BUFRMessage
+    void decode_columns(BUFRColumns& columns);
+
+    // Only these elements are decoded, see BUFRMessage
+    void set_projection(const std::vector<uint16_t>& descriptors, const std::vector<std::string>& mnemonics);
+
+    // Threads for the subsets of uncompressed messages, see BUFRMessage
+    void set_decode_threads(const unsigned int threads);
+
     void get_values_for_subset(std::vector<std::vector<const NodeItem*>>& values_data_nodes,
                                const unsigned int subset_num = 0);
 
@@ -89,12 +122,23 @@ public:
     std::vector<FXY> m_data_descriptor_list;
 
     void parse(std::ifstream& ifile, const std::ios::pos_type file_offset);
+    void parse(const std::shared_ptr<BUFRSource>& source, const size_t file_offset, const size_t len_bufr);
 
 private:
     BUFRDecoder(const BUFRDecoder&) = delete;
     BUFRDecoder& operator=(BUFRDecoder const&) = delete;
 
-    uint8_t* m_buffer{nullptr};
+    // m_buffer points either to m_owned_buffer or straight into the memory mapped m_source.
+    // Messages from other sources are read up to the end of section 3 (m_buffer_length octets),
+    // the rest is read from m_source when section 4 is needed.
+    const uint8_t* m_buffer{nullptr};
+    size_t m_buffer_length{0};
+    uint8_t* m_owned_buffer{nullptr};
+    size_t m_owned_capacity{0};
+    std::shared_ptr<BUFRSource> m_source{};
+    size_t m_source_offset{0};
+    size_t m_source_length{0};
+    uint8_t m_sec5[4]{};
 
     size_t m_sec0_offset{0};
     size_t m_sec1_offset{0};
@@ -110,7 +154,14 @@ private:
     size_t m_sec4_length{0};
     size_t m_sec5_length{0};
 
+    void parse_buffer(const size_t file_offset, const size_t len_bufr);
     void parse_sections();
+    void read_from_source(const size_t len);
+    void reserve_owned_buffer(const size_t len, const size_t keep);
+    void require(const size_t len);
+    void load_section_4();
+    size_t readable_octets(const size_t offset) const;
+    void check_increments(const BitReader& br, const unsigned int bits) const;
 
     void decode_section_0();
     void decode_section_1();
@@ -121,12 +172,60 @@ private:
     void read_table_a_ncep(std::vector<FXY>& descriptor_list, BitReader& br);
     void read_table_a_ecmwf(std::vector<FXY>& descriptor_list, BitReader& br);
 
+    const DecodeProgram* decode_program();
+    void reset_subset_state();
+    void prepare_projection(const bool code_flag_conditions);
+    bool skip_element(const FXY fxy, BitReader& br, const bool bit_width_plus_one = false);
+
+    void run_decode_program_columns(const std::vector<DecodeOp>& ops,
+                                    const size_t first,
+                                    const size_t last,
+                                    const unsigned int iterations,
+                                    BitReader& br);
+    void decode_column_subset(const DecodeProgram& program, const unsigned int subset, BitReader& br);
+
+    // Parallel decoding of the subsets of uncompressed messages
+    unsigned int decode_threads() const;
+    unsigned int subset_threads(const DecodeProgram* const program) const;
+    bool find_subset_offsets(const DecodeProgram& program, BitReader& br, std::vector<size_t>& offsets);
+    void run_skip_program(const std::vector<DecodeOp>& ops,
+                          const size_t first,
+                          const size_t last,
+                          const unsigned int iterations,
+                          BitReader& br);
+    std::vector<unsigned int> subset_ranges(const unsigned int first, const unsigned int threads, const unsigned int align) const;
+    void decode_subsets_parallel(const std::vector<size_t>& offsets,
+                                 const std::vector<unsigned int>& ranges,
+                                 const std::function<void(BUFRDecoder&, const unsigned int, BitReader&)>& decode_subset);
+    void init_subset_worker(const BUFRDecoder& message);
+    BUFRColumn& next_column(const FXY fxy, const bool is_string, const int scale, const int reference, const int bits);
+    void read_element_column(const FXY fxy, BitReader& br, const bool bit_width_plus_one = false);
+
     void read_descriptor_list(const std::vector<FXY>& descriptor_list,
                               const unsigned int iterations,
                               BitReader& br,
                               const int indent,
                               NodeItem* parent_nodeitem);
 
+    void run_decode_program(const std::vector<DecodeOp>& ops,
+                            const size_t first,
+                            const size_t last,
+                            const unsigned int iterations,
+                            BitReader& br,
+                            const int indent,
+                            NodeItem* parent_nodeitem);
+
+    struct ElementEncoding {
+        int scale{0};
+        int reference{0};
+        int bit_width{0};
+        bool new_ref_value{false};
+        bool new_scale{false};
+        bool new_bits{false};
+    };
+    ElementEncoding element_encoding(const DescriptorTableB& desc, const bool bit_width_plus_one) const;
+    void apply_reference_operators(const DescriptorTableB& desc, ElementEncoding& encoding) const;
+
     void read_element_descriptor(const FXY fxy,
                                  BitReader& br,
                                  Item& item,
@@ -141,6 +240,15 @@ private:
                                      const std::vector<FXY>& descriptor_list,
                                      size_t& desc);
 
+    unsigned int read_delayed_replication_factor(const FXY fxy,
+                                                 const FXY next_desc,
+                                                 BitReader& br,
+                                                 NodeItem* const parent_nodeitem,
+                                                 const int indent);
+    unsigned int read_delayed_replication_factor(const FXY next_desc, BitReader& br);
+    unsigned int read_drp_factor(const FXY fxy, BitReader& br, std::string& sequence_str);
+    unsigned int replicated_body_count(const bool delayed, BitReader& br);
+
     void read_operator_descriptor(const FXY fxy,
                                   const FXY fxy_next,
                                   BitReader& br,
@@ -156,10 +264,14 @@ private:
                                   const std::vector<FXY>& descriptor_list,
                                   size_t& desc);
 
-    TableA* m_tablea{nullptr};
-    TableB* m_tableb{nullptr};
-    TableD* m_tabled{nullptr};
-    TableF* m_tablef{nullptr};
+    const TableA* m_tablea{nullptr};
+    const TableB* m_tableb{nullptr};
+    const TableD* m_tabled{nullptr};
+    const TableF* m_tablef{nullptr};
+    // table definitions in the data are added to these, nullptr for shared tables
+    TableA* m_writable_tablea{nullptr};
+    TableB* m_writable_tableb{nullptr};
+    TableD* m_writable_tabled{nullptr};
 
     int m_new_data_width{0};
     int m_new_scale{0};
@@ -172,9 +284,60 @@ private:
     std::map<FXY, int> m_new_reference_values{};
     std::map<FXY, double> m_loaded_b_descriptors{};
 
+    // compiled m_data_descriptor_list, nullptr if it can not be compiled
+    std::shared_ptr<const DecodeProgram> m_program{};
+    bool m_program_loaded{false};
+    // m_program was compiled from these, kept by reset
+    std::vector<FXY> m_program_descriptors{};
+    uint64_t m_program_tabled_generation{0};
+    uint64_t m_program_tableb_generation{0};
+
+    std::vector<uint16_t> m_projection_descriptors{};
+    std::vector<std::string> m_projection_mnemonics{};
+    std::vector<bool> m_projection{}; // indexed by FXY
+    bool m_projection_active{false};
+
+    unsigned int m_decode_threads{1};
+    // first pass of the parallel decoding, elements are skipped without a projection
+    bool m_skip_pass{false};
+    Item m_skip_item{};
+
+    // output of decode_columns
+    BUFRColumns* m_columns{nullptr};
+    unsigned int m_column_subset{0};
+    size_t m_column_index{0};
+
     bool m_construction_of_bitmap{false};
     std::vector<int> m_bitmap{};
 
+    // Increments of one compressed element (94.6.3), for all subsets of an item or a column
+    struct CompressedIncrements {
+        Item* item{nullptr};  // decode_section_4
+        size_t column{0};     // decode_columns
+        size_t pos{0};        // of the first increment
+        unsigned int bits{0}; // NBINC, octets * 8 for character elements
+        int64_t base{0};      // R0, for items plus the reference value
+        int scale{0};         // items only
+        bool check_missing{false};
+        bool is_string{false};
+    };
+    // scratch space for the increments of one compressed element
+    struct IncrementBuffers {
+        std::vector<uint32_t> increments{};
+        std::vector<double> values{};
+        std::vector<uint8_t> missing{};
+    };
+    void unpack_increments(const CompressedIncrements& increments, BitReader& br, IncrementBuffers& buffers) const;
+    IncrementBuffers m_increment_buffers{};
+
+    // Increments of large compressed messages are skipped while the data section is read
+    // and unpacked afterwards, element by element in parallel
+    unsigned int compressed_threads(const DecodeProgram* const program) const;
+    bool defer_increments(const CompressedIncrements& increments, BitReader& br);
+    void unpack_deferred_increments();
+    bool m_defer_increments{false};
+    std::vector<CompressedIncrements> m_deferred_increments{};
+
     std::vector<FXY> m_expanded_descriptors_for_bitmap{};
     unsigned int m_current_bitmap_index{0};
     int m_backward_reference{-1}; // undefined
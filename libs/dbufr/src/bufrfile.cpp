@@ -22,15 +22,16 @@
 #include "bufrfile.h"
 
 #include "bufrdecoder.h"
+#include "bufrgzipsource.h"
+#include "bufrindex.h"
 #include "bufrmessage.h"
-#include "bufrutil.h"
-#include "descriptortableb.h"
-#include "tablea.h"
-#include "tableb.h"
-#include "tabled.h"
-#include "tablef.h"
+#include "bufrprefetcher.h"
+#include "bufrsource.h"
+#include "bufrtables.h"
 
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -38,56 +39,32 @@
 class BUFRFile::PrivateData
 {
 public:
-    std::ifstream ifile;
-    std::vector<std::ios::pos_type> offset;
-
-    int curr_master_table_number{0};
-    int curr_master_table_version{0};
-    int curr_originating_center{0};
-    int curr_originating_subcenter{0};
-    int curr_local_table_version{0};
-
-    TableA tablea;
-    TableB tableb;
-    TableD tabled;
-    TableF tablef;
+    std::string filename;
+    std::shared_ptr<BUFRSource> source;
+    std::vector<size_t> offset;
+    std::vector<size_t> length;
+    std::vector<BUFRIndexEntry> index_entries;
+
+    // Tables of the table messages at the beginning of the file, or database
+    // tables by version. Never removed, messages keep pointers to them.
+    std::unique_ptr<BUFRTables> builtin_tables;
+    std::map<TableVersions, std::unique_ptr<BUFRTables>> db_tables;
+    // tables of the last message, for names and dumps
+    BUFRTables* current_tables{nullptr};
+    std::mutex tables_mutex;
+
+    std::unique_ptr<BUFRPrefetcher> prefetcher;
 
     unsigned int total_num_messages{0};
-    unsigned int num_table_messages{0};
-    bool has_builtin_tables{false};
 };
 
-BUFRFile::BUFRFile(const std::string& filename)
+BUFRFile::BUFRFile(const std::string& filename, const BUFRFileOptions& options)
     : d(new PrivateData)
 {
-    d->curr_master_table_number = -1;
-    d->curr_master_table_version = -1;
-    d->curr_originating_center = -1;
-    d->curr_originating_subcenter = -1;
-    d->curr_local_table_version = -1;
-    d->num_table_messages = 0;
-    d->has_builtin_tables = false;
-
-    d->ifile.open(filename.c_str(), std::ios::in | std::ios::binary);
-    if (!d->ifile) {
-        std::ostringstream ostr;
-        ostr << "Error opening file: " << filename;
-        throw std::runtime_error(ostr.str());
-    }
-
-    d->ifile.seekg(0, std::ios::end);
-    const std::ios::pos_type filesize = d->ifile.tellg();
-    std::ios::pos_type pos = 0;
+    d->filename = filename;
+    d->source = open_bufr_source(filename);
 
-    while (!d->ifile.eof() && pos < filesize) {
-        size_t len_bufr;
-        pos = seek_bufr(d->ifile, pos, len_bufr);
-        if (pos < 0) {
-            break;
-        }
-        d->offset.push_back(pos);
-        pos = pos + (std::ios::pos_type)len_bufr;
-    }
+    find_messages(filename, *d->source, options.scan_threads, d->offset, d->length, d->index_entries);
 
     if (d->offset.empty()) {
         std::ostringstream ostr;
@@ -97,100 +74,39 @@ BUFRFile::BUFRFile(const std::string& filename)
 
     d->total_num_messages = (unsigned int)d->offset.size();
 
-    int current_message = 0;
-
-    // loop until we load all data_cat==11 messages
-    for (;;) {
-
+    // load all data_cat==11 messages
+    std::unique_ptr<BUFRTables> tables(new BUFRTables);
+    for (unsigned int i = 0; i < d->total_num_messages; i++) {
         BUFRMessage bm;
-        bm.parse(d->ifile, d->offset[current_message]);
-
-        current_message++;
-
-        if (current_message == 1) {
-            if (bm.data_cat() == 11) {
-                // add to TableB set of standard tableb descriptors used to build BUFR table entries
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 1, "TABLAE  ", "Table A: entry", "CCITT_IA5", 0, 0, 24));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 2, "TABLAD1 ", "Table A: data category description, line 1", "CCITT_IA5", 0, 0, 256));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 3, "TABLAD2 ", "Table A: data category description, line 2", "CCITT_IA5", 0, 0, 256));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 4, "MTABL   ", "BUFR/CREX Master table (see Note 1)", "CCITT_IA5", 0, 0, 16));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 5, "BUFREDN ", "BUFR/CREX edition number", "CCITT_IA5", 0, 0, 24));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 6, "BMTVN   ", "BUFR Master table Version number (see Note 2)", "CCITT_IA5", 0, 0, 16));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 7, "CMTVN   ", "CREX Master table version number (see Note 3)", "CCITT_IA5", 0, 0, 16));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 8, "BLTVN   ", "BUFR Local table version number (see Note 4)", "CCITT_IA5", 0, 0, 16));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 10, "FDESC   ", "F descriptor to be added or defined", "CCITT_IA5", 0, 0, 8));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 11, "XDESC   ", "X descriptor to be added or defined", "CCITT_IA5", 0, 0, 16));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 12, "YDESC   ", "Y descriptor to be added or defined", "CCITT_IA5", 0, 0, 24));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 13, "ELEMNA1 ", "Element name, line 1", "CCITT_IA5", 0, 0, 256));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 14, "ELEMNA2 ", "Element name, line 2", "CCITT_IA5", 0, 0, 256));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 15, "UNITSNA ", "Units name", "CCITT_IA5", 0, 0, 192));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 16, "SCALESG ", "Units scale sign", "CCITT_IA5", 0, 0, 8));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 17, "SCALEU  ", "Units scale", "CCITT_IA5", 0, 0, 24));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 18, "REFERSG ", "Units reference sign", "CCITT_IA5", 0, 0, 8));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 19, "REFERVA ", "Units reference value", "CCITT_IA5", 0, 0, 80));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 20, "ELEMDWD ", "Element data width", "CCITT_IA5", 0, 0, 24));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 24, "CODFIG  ", "Code figure", "CCITT_IA5", 0, 0, 64));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 25, "CODFIGM ", "Code figure meaning", "CCITT_IA5", 0, 0, 496));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 26, "BITNUM  ", "Bit number", "CCITT_IA5", 0, 0, 48));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 27, "BITNUMM ", "Bit number meaning", "CCITT_IA5", 0, 0, 496));
-                d->tableb.add_descriptor(DescriptorTableB(0, 0, 30, "DDSEQ   ", "Descriptor defining sequence", "CCITT_IA5", 0, 0, 48));
-
-                d->tablef.set_versions(bm.master_table_number(),
-                                       bm.master_table_version(),
-                                       bm.originating_center(),
-                                       bm.originating_subcenter(),
-                                       bm.local_table_version());
-
-            } else {
-
-                d->tableb.set_versions(bm.master_table_number(),
-                                       bm.master_table_version(),
-                                       bm.originating_center(),
-                                       bm.originating_subcenter(),
-                                       bm.local_table_version());
-                d->tableb.read_from_db();
-
-                d->tabled.set_versions(bm.master_table_number(),
-                                       bm.master_table_version(),
-                                       bm.originating_center(),
-                                       bm.originating_subcenter(),
-                                       bm.local_table_version());
-                d->tabled.read_from_db();
-
-                d->tablef.set_versions(bm.master_table_number(),
-                                       bm.master_table_version(),
-                                       bm.originating_center(),
-                                       bm.originating_subcenter(),
-                                       bm.local_table_version());
-                // d->tablef.read_from_db();
-
-                d->curr_master_table_number = bm.master_table_number();
-                d->curr_master_table_version = bm.master_table_version();
-                d->curr_originating_center = bm.originating_center();
-                d->curr_originating_subcenter = bm.originating_subcenter();
-                d->curr_local_table_version = bm.local_table_version();
+        bm.parse(d->source, d->offset[i], d->length[i]);
+        if (!tables->load_table_message(bm)) {
+            if (!tables->has_builtin_tables()) {
+                // tables of the first message were read from the database
+                d->db_tables[BUFRTables::versions_of(bm)] = std::move(tables);
             }
-        }
-
-        bm.set_tables(&d->tablea, &d->tableb, &d->tabled, &d->tablef);
-
-        if (bm.data_cat() == 11) {
-            if (bm.load_tables() == 0) {
-                break;
-            }
-            d->num_table_messages++;
-            d->has_builtin_tables = true;
-        } else {
-            // done loading all data_cat == 11 messages
-            // assuming they are all at the beginning of the file before any other message
             break;
         }
     }
+    if (tables) {
+        d->builtin_tables = std::move(tables);
+    }
+    d->current_tables = d->builtin_tables ? d->builtin_tables.get() : d->db_tables.begin()->second.get();
+
+    if (options.readahead_messages > 0) {
+        d->prefetcher.reset(new BUFRPrefetcher(d->source, d->offset, d->length, options.readahead_messages));
+    }
 }
 
 BUFRFile::~BUFRFile() = default;
 
 BUFRMessage BUFRFile::get_message_num(const unsigned int message_num) const
+{
+    BUFRMessage bm;
+    get_message_num(message_num, bm);
+    return bm;
+}
+
+void BUFRFile::get_message_num(const unsigned int message_num, BUFRMessage& bm) const
 {
     // skip first few messages that contain bufr tables
     // const unsigned int actual_message_num = d->num_table_messages + message_num - 1;
@@ -202,49 +118,119 @@ BUFRMessage BUFRFile::get_message_num(const unsigned int message_num) const
         throw std::runtime_error(estr.str());
     }
 
-    BUFRMessage bm;
-    bm.parse(d->ifile, d->offset[actual_message_num]);
-
-    if (!d->has_builtin_tables) {
-        // reload tables in case different messages use different tables
-        if (d->curr_master_table_number != bm.master_table_number()
-            || d->curr_master_table_version != bm.master_table_version()
-            || d->curr_originating_center != bm.originating_center()
-            || d->curr_originating_subcenter != bm.originating_subcenter()
-            || d->curr_local_table_version != bm.local_table_version()) {
-
-            d->tableb.set_versions(bm.master_table_number(),
-                                   bm.master_table_version(),
-                                   bm.originating_center(),
-                                   bm.originating_subcenter(),
-                                   bm.local_table_version());
-            d->tableb.read_from_db();
-
-            d->tabled.set_versions(bm.master_table_number(),
-                                   bm.master_table_version(),
-                                   bm.originating_center(),
-                                   bm.originating_subcenter(),
-                                   bm.local_table_version());
-            d->tabled.read_from_db();
-
-            d->tablef.set_versions(bm.master_table_number(),
-                                   bm.master_table_version(),
-                                   bm.originating_center(),
-                                   bm.originating_subcenter(),
-                                   bm.local_table_version());
-            // d->tablef.readFromDB();
-
-            d->curr_master_table_number = bm.master_table_number();
-            d->curr_master_table_version = bm.master_table_version();
-            d->curr_originating_center = bm.originating_center();
-            d->curr_originating_subcenter = bm.originating_subcenter();
-            d->curr_local_table_version = bm.local_table_version();
+    bm.reset();
+    if (d->prefetcher) {
+        size_t pos;
+        const std::shared_ptr<BUFRSource> source = d->prefetcher->get(actual_message_num, pos);
+        bm.parse(source, pos, d->length[actual_message_num]);
+    } else {
+        bm.parse(d->source, d->offset[actual_message_num], d->length[actual_message_num]);
+    }
+
+    std::lock_guard<std::mutex> lock(d->tables_mutex);
+    BUFRTables* tables = d->builtin_tables.get();
+    if (tables == nullptr) {
+        std::unique_ptr<BUFRTables>& versioned = d->db_tables[BUFRTables::versions_of(bm)];
+        if (!versioned) {
+            versioned.reset(new BUFRTables);
+        }
+        tables = versioned.get();
+    }
+    tables->set_tables_for(bm);
+    d->current_tables = tables;
+}
+
+void BUFRFile::read_metadata(BUFRMetadataTable& table) const
+{
+    const size_t n = d->total_num_messages;
+
+    table.offset.assign(d->offset.begin(), d->offset.end());
+    table.length.assign(d->length.begin(), d->length.end());
+    table.edition.resize(n);
+    table.master_table_number.resize(n);
+    table.originating_center.resize(n);
+    table.originating_subcenter.resize(n);
+    table.data_cat.resize(n);
+    table.master_table_version.resize(n);
+    table.local_table_version.resize(n);
+    table.year.resize(n);
+    table.month.resize(n);
+    table.day.resize(n);
+    table.hour.resize(n);
+    table.minute.resize(n);
+    table.second.resize(n);
+    table.number_of_data_subsets.resize(n);
+    table.flag_compressed.resize(n);
+
+    if (d->index_entries.size() == n) {
+        for (size_t i = 0; i < n; i++) {
+            const BUFRIndexEntry& e = d->index_entries[i];
+            table.edition[i] = e.edition;
+            table.master_table_number[i] = e.master_table_number;
+            table.originating_center[i] = e.originating_center;
+            table.originating_subcenter[i] = e.originating_subcenter;
+            table.data_cat[i] = e.data_cat;
+            table.master_table_version[i] = e.master_table_version;
+            table.local_table_version[i] = e.local_table_version;
+            table.year[i] = e.year;
+            table.month[i] = e.month;
+            table.day[i] = e.day;
+            table.hour[i] = e.hour;
+            table.minute[i] = e.minute;
+            table.second[i] = e.second;
+            table.number_of_data_subsets[i] = e.number_of_data_subsets;
+            table.flag_compressed[i] = e.flag_compressed;
         }
+        return;
     }
 
-    bm.set_tables(&d->tablea, &d->tableb, &d->tabled, &d->tablef);
+    for (size_t i = 0; i < n; i++) {
+        BUFRMessage bm;
+        bm.parse(d->source, d->offset[i], d->length[i]);
+        table.edition[i] = bm.edition();
+        table.master_table_number[i] = bm.master_table_number();
+        table.originating_center[i] = bm.originating_center();
+        table.originating_subcenter[i] = bm.originating_subcenter();
+        table.data_cat[i] = bm.data_cat();
+        table.master_table_version[i] = bm.master_table_version();
+        table.local_table_version[i] = bm.local_table_version();
+        table.year[i] = bm.year();
+        table.month[i] = bm.month();
+        table.day[i] = bm.day();
+        table.hour[i] = bm.hour();
+        table.minute[i] = bm.minute();
+        table.second[i] = bm.second();
+        table.number_of_data_subsets[i] = bm.number_of_data_subsets();
+        table.flag_compressed[i] = bm.flag_compressed();
+    }
+}
 
-    return bm;
+BUFRReadStats BUFRFile::read_stats() const
+{
+    return d->prefetcher ? d->prefetcher->stats() : BUFRReadStats();
+}
+
+void BUFRFile::write_index() const
+{
+    BUFRIndex index;
+    index.entries.resize(d->total_num_messages);
+
+    for (unsigned int i = 0; i < d->total_num_messages; i++) {
+        BUFRMessage bm;
+        bm.parse(d->source, d->offset[i], d->length[i]);
+
+        BUFRIndexEntry& entry = index.entries[i];
+        entry.offset = d->offset[i];
+        entry.length = (uint32_t)d->length[i];
+        BUFRIndex::fill_entry(bm, entry);
+    }
+
+    index.save(d->filename);
+
+    const GzipFileSource* gzip_source = dynamic_cast<const GzipFileSource*>(d->source.get());
+    if (gzip_source) {
+        gzip_source->save_index();
+    }
 }
 
 unsigned int BUFRFile::num_messages() const
@@ -254,34 +240,34 @@ unsigned int BUFRFile::num_messages() const
 
 unsigned int BUFRFile::num_table_messages() const
 {
-    return d->num_table_messages;
+    return d->builtin_tables ? d->builtin_tables->num_table_messages() : 0;
 }
 
 std::string BUFRFile::get_tableb_name() const
 {
-    return d->tableb.get_master_table_name() + "/" + d->tableb.get_local_table_name();
+    std::lock_guard<std::mutex> lock(d->tables_mutex);
+    return d->current_tables->get_tableb_name();
 }
 
 std::string BUFRFile::get_tabled_name() const
 {
-    return d->tabled.get_master_table_name() + "/" + d->tabled.get_local_table_name();
+    std::lock_guard<std::mutex> lock(d->tables_mutex);
+    return d->current_tables->get_tabled_name();
 }
 
 std::string BUFRFile::get_tablef_name() const
 {
-    return d->tablef.get_master_table_name() + "/" + d->tablef.get_local_table_name();
+    std::lock_guard<std::mutex> lock(d->tables_mutex);
+    return d->current_tables->get_tablef_name();
 }
 
 bool BUFRFile::has_builtin_tables() const
 {
-    return d->has_builtin_tables;
+    return d->builtin_tables != nullptr;
 }
 
 void BUFRFile::dump_tables(std::ostream& ostr) const
 {
-    d->tablea.dump(ostr);
-    d->tabled.dump1(d->tablea, ostr);
-    d->tableb.dump1(ostr);
-    d->tabled.dump2(d->tableb, ostr);
-    d->tableb.dump2(ostr);
+    std::lock_guard<std::mutex> lock(d->tables_mutex);
+    d->current_tables->dump_tables(ostr);
 }
@@ -0,0 +1,356 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrframing.h"
+
+#include "bufrsource.h"
+#include "bufrutil.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static const uint8_t SOH = 0x01;
+static const uint8_t ETX = 0x03;
+
+static const size_t heading_block_size = 4096;
+static const size_t read_block_size = 64 * 1024;
+
+// Framing is followed with many reads of a few octets, mostly increasing positions.
+// Sources without data() are read in blocks.
+class FramingReader
+{
+public:
+    explicit FramingReader(BUFRSource& source)
+        : m_source(source)
+        , m_data(source.data())
+        , m_size(source.size())
+    {
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // len must not be larger than read_block_size
+    void read(const size_t pos, const size_t len, uint8_t* buffer)
+    {
+        if (m_data != nullptr) {
+            std::memcpy(buffer, m_data + pos, len);
+            return;
+        }
+        if (pos < m_block_start || pos + len > m_block_start + m_block.size()) {
+            m_block_start = pos;
+            m_block.resize(std::min(read_block_size, m_size - pos));
+            m_source.read(m_block_start, m_block.size(), m_block.data());
+        }
+        std::memcpy(buffer, m_block.data() + (pos - m_block_start), len);
+    }
+
+private:
+    BUFRSource& m_source;
+    const uint8_t* const m_data;
+    const size_t m_size;
+    std::vector<uint8_t> m_block;
+    size_t m_block_start{0};
+};
+
+static bool is_bufr_marker(const uint8_t* p)
+{
+    return p[0] == 'B' && p[1] == 'U' && p[2] == 'F' && p[3] == 'R';
+}
+
+static bool is_fill(const uint8_t c)
+{
+    return c == 0 || c == '\r' || c == '\n' || c == ' ';
+}
+
+static uint64_t get_marker(const uint8_t* p, const int size, const bool big_endian)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++) {
+        const int shift = big_endian ? 8 * (size - 1 - i) : 8 * i;
+        v |= (uint64_t)p[i] << shift;
+    }
+    return v;
+}
+
+// 8 digit bulletin length followed by format identifier 00 (with SOH and ETX) or 01 (without)
+static bool get_bulletin_length(const uint8_t* p, size_t& len)
+{
+    len = 0;
+    for (int i = 0; i < 8; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        len = len * 10 + (size_t)(p[i] - '0');
+    }
+    return p[8] == '0' && (p[9] == '0' || p[9] == '1');
+}
+
+// Check the message at pos, which must end at or before 'end'. Returns its length or 0.
+static size_t check_message(FramingReader& source, const size_t pos, const size_t end)
+{
+    if (pos + 8 > end) {
+        return 0;
+    }
+
+    std::array<uint8_t, 8> sec0{};
+    source.read(pos, sec0.size(), sec0.data());
+    if (!is_bufr_marker(sec0.data())) {
+        return 0;
+    }
+
+    const size_t len = check_bufr_section_0(sec0.data());
+    if (len == 0 || pos + len > end) {
+        return 0;
+    }
+
+    std::array<uint8_t, 4> buf7777{};
+    source.read(pos + len - 4, buf7777.size(), buf7777.data());
+    return is_7777(buf7777.data()) ? len : 0;
+}
+
+BUFRFraming detect_framing(BUFRSource& source)
+{
+    BUFRFraming framing;
+
+    const size_t size = source.size();
+    std::array<uint8_t, 16> head{};
+    if (size < 46 + head.size()) {
+        return framing;
+    }
+    source.read(0, head.size(), head.data());
+
+    for (const int marker_size : {4, 8}) {
+        for (const bool big_endian : {false, true}) {
+            const uint64_t n = get_marker(head.data(), marker_size, big_endian);
+            if (n < 46 || n > size - 2 * marker_size || !is_bufr_marker(head.data() + marker_size)) {
+                continue;
+            }
+            std::array<uint8_t, 8> trailer{};
+            source.read(marker_size + n, marker_size, trailer.data());
+            if (get_marker(trailer.data(), marker_size, big_endian) == n) {
+                framing.type = BUFRFraming::Type::FortranRecord;
+                framing.marker_size = marker_size;
+                framing.big_endian = big_endian;
+                return framing;
+            }
+        }
+    }
+
+    size_t bulletin_len;
+    if (head[0] == SOH || get_bulletin_length(head.data(), bulletin_len)) {
+        framing.type = BUFRFraming::Type::GTSBulletin;
+    }
+
+    return framing;
+}
+
+static size_t scan_fortran_records(FramingReader& source, const BUFRFraming& framing,
+                                   std::vector<size_t>& offset, std::vector<size_t>& length)
+{
+    const size_t size = source.size();
+    const int marker_size = framing.marker_size;
+    std::array<uint8_t, 8> marker{};
+
+    size_t pos = 0;
+    while (pos + 2 * marker_size <= size) {
+        source.read(pos, marker_size, marker.data());
+        const uint64_t n = get_marker(marker.data(), marker_size, framing.big_endian);
+        if (n > size - pos - 2 * marker_size) {
+            break;
+        }
+
+        // one or more consecutive messages at the start of the record
+        const size_t num_found = offset.size();
+        const size_t record_end = pos + marker_size + n;
+        size_t p = pos + marker_size;
+        size_t len;
+        while ((len = check_message(source, p, record_end)) > 0) {
+            offset.push_back(p);
+            length.push_back(len);
+            p += len;
+        }
+
+        // the trailing marker is read last, reads stay in increasing order
+        source.read(record_end, marker_size, marker.data());
+        if (p == pos + (size_t)marker_size || get_marker(marker.data(), marker_size, framing.big_endian) != n) {
+            offset.resize(num_found);
+            length.resize(num_found);
+            break;
+        }
+
+        pos = record_end + marker_size;
+    }
+
+    return pos;
+}
+
+// Find "BUFR" or ETX (a bulletin without a BUFR message) in the heading starting at 'start'.
+static bool find_heading_end(FramingReader& source, const size_t start, const size_t end,
+                             size_t& found_pos, bool& found_etx)
+{
+    std::vector<uint8_t> block(heading_block_size);
+
+    size_t p = start;
+    while (p < end) {
+        const size_t n = std::min(heading_block_size, end - p);
+        source.read(p, n, block.data());
+
+        size_t i = 0;
+        for (; i < n; i++) {
+            if (block[i] == ETX) {
+                found_pos = p + i;
+                found_etx = true;
+                return true;
+            }
+            if (block[i] == 'B') {
+                if (i + 4 > n) {
+                    // continue in the next block, starting with this octet
+                    if (p + n == end) {
+                        return false;
+                    }
+                    break;
+                }
+                if (is_bufr_marker(block.data() + i)) {
+                    found_pos = p + i;
+                    found_etx = false;
+                    return true;
+                }
+            }
+        }
+        p += i;
+    }
+
+    return false;
+}
+
+// Skip octets that may pad bulletins (NUL, CR, LF, space). Returns the position of the first other octet.
+static size_t skip_fill(FramingReader& source, size_t pos)
+{
+    const size_t size = source.size();
+    std::array<uint8_t, 64> block{};
+
+    while (pos < size) {
+        const size_t n = std::min(block.size(), size - pos);
+        source.read(pos, n, block.data());
+        for (size_t i = 0; i < n; i++) {
+            if (!is_fill(block[i])) {
+                return pos + i;
+            }
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+static size_t scan_gts_bulletins(FramingReader& source, std::vector<size_t>& offset, std::vector<size_t>& length)
+{
+    const size_t size = source.size();
+    std::array<uint8_t, 16> buf{};
+
+    size_t pos = 0;
+    for (;;) {
+        pos = skip_fill(source, pos);
+        if (pos >= size) {
+            break;
+        }
+
+        // bulletin length is known only in files with the length prefix
+        size_t bulletin_start = pos;
+        size_t bulletin_end = size;
+        bool has_length = false;
+        const size_t nhead = std::min(buf.size(), size - pos);
+        source.read(pos, nhead, buf.data());
+        size_t bulletin_len;
+        if (nhead >= 10 && get_bulletin_length(buf.data(), bulletin_len)) {
+            bulletin_start = pos + 10;
+            bulletin_end = bulletin_start + bulletin_len;
+            if (bulletin_end > size) {
+                break;
+            }
+            has_length = true;
+        } else if (buf[0] != SOH) {
+            break;
+        }
+
+        size_t found_pos;
+        bool found_etx;
+        if (!find_heading_end(source, bulletin_start, bulletin_end, found_pos, found_etx)) {
+            if (has_length) {
+                pos = bulletin_end;
+                continue;
+            }
+            break;
+        }
+
+        if (found_etx) {
+            pos = has_length ? bulletin_end : found_pos + 1;
+            continue;
+        }
+
+        const size_t len = check_message(source, found_pos, bulletin_end);
+        if (len == 0) {
+            break;
+        }
+        offset.push_back(found_pos);
+        length.push_back(len);
+
+        if (has_length) {
+            pos = bulletin_end;
+            continue;
+        }
+
+        // the message is followed by CR CR LF and ETX
+        const size_t message_end = found_pos + len;
+        const size_t ntail = std::min(buf.size(), size - message_end);
+        source.read(message_end, ntail, buf.data());
+        size_t i = 0;
+        while (i < ntail && is_fill(buf[i])) {
+            i++;
+        }
+        if (i == ntail || buf[i] != ETX) {
+            pos = message_end;
+            break;
+        }
+        pos = message_end + i + 1;
+    }
+
+    return std::min(pos, size);
+}
+
+size_t scan_framed(BUFRSource& source, const BUFRFraming& framing,
+                   std::vector<size_t>& offset, std::vector<size_t>& length)
+{
+    FramingReader reader(source);
+
+    switch (framing.type) {
+    case BUFRFraming::Type::FortranRecord:
+        return scan_fortran_records(reader, framing, offset, length);
+    case BUFRFraming::Type::GTSBulletin:
+        return scan_gts_bulletins(reader, offset, length);
+    case BUFRFraming::Type::None:
+        break;
+    }
+    return 0;
+}
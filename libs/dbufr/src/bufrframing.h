@@ -0,0 +1,50 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class BUFRSource;
+
+// Envelope around the BUFR messages of a file, recognized from its first octets.
+// Framed files are scanned by following the record lengths instead of searching for "BUFR".
+struct BUFRFraming {
+    enum class Type {
+        None,
+        FortranRecord, // Fortran sequential records, record length before and after each record
+        GTSBulletin    // WMO bulletins: SOH, abbreviated heading, message, ETX. Optionally preceded
+                       // by the 8 digit bulletin length and 2 digit format identifier (00 or 01)
+    };
+
+    Type type{Type::None};
+    int marker_size{4}; // octets in a Fortran record marker, 4 or 8
+    bool big_endian{false};
+};
+
+BUFRFraming detect_framing(BUFRSource& source);
+
+// Append all messages found by following the framing from the start of the source.
+// Returns the position after the last complete record. That is the size of the
+// source unless the framing is broken, the rest must then be searched.
+size_t scan_framed(BUFRSource& source, const BUFRFraming& framing,
+                   std::vector<size_t>& offset, std::vector<size_t>& length);
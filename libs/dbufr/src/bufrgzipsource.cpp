@@ -0,0 +1,506 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrgzipsource.h"
+
+#include "bufrutil.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(DBUFR_WITH_ZLIB)
+
+#include <zlib.h>
+
+static const size_t window_size = 32768;
+static const size_t span = 1024 * 1024;       // uncompressed distance between access points
+static const size_t chunk_size = 1024 * 1024; // uncompressed octets produced by one inflate call in read()
+static const size_t input_size = 64 * 1024;
+
+static const char gzindex_magic[8] = {'D', 'B', 'U', 'F', 'R', 'G', 'Z', 'X'};
+static const uint32_t gzindex_version = 1;
+static const size_t gzindex_header_size = 48;
+static const size_t gzindex_point_size = 24;
+
+struct AccessPoint {
+    uint64_t out{0};          // uncompressed offset
+    uint64_t in{0};           // compressed offset of the first complete octet
+    int bits{0};              // number of bits of the octet before 'in' that are needed
+    bool member_start{false}; // a gzip header starts at 'in'
+    std::vector<uint8_t> window{};
+};
+
+class GzipFileSource::PrivateData
+{
+public:
+    ~PrivateData()
+    {
+        if (strm_init) {
+            inflateEnd(&strm);
+        }
+    }
+
+    std::string filename;
+    std::ifstream ifile;
+    uint64_t file_size{0};
+    int64_t file_mtime{0};
+
+    std::vector<AccessPoint> points;
+    uint64_t size{0};
+
+    // inflate state of read(), out_pos is the uncompressed offset of the next output octet
+    z_stream strm{};
+    bool strm_init{false};
+    bool raw{false};
+    bool at_end{false};
+    std::vector<uint8_t> input;
+    uint64_t out_pos{0};
+
+    // output of the last two inflate calls
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> prev_chunk;
+    uint64_t chunk_start{0};
+    uint64_t prev_chunk_start{0};
+    size_t chunk_len{0};
+    size_t prev_chunk_len{0};
+
+    void init_inflate(const int window_bits);
+    size_t refill_input();
+    bool next_member();
+    void build_index();
+    bool load_index();
+    void start_at(const AccessPoint& point);
+    size_t inflate_output(uint8_t* out, const size_t len);
+    void next_chunk();
+};
+
+void GzipFileSource::PrivateData::init_inflate(const int window_bits)
+{
+    if (strm_init) {
+        inflateEnd(&strm);
+        strm_init = false;
+    }
+    strm = z_stream{};
+    if (inflateInit2(&strm, window_bits) != Z_OK) {
+        throw std::runtime_error(fmt::format("GzipFileSource: inflateInit2 failed for {}", filename));
+    }
+    strm_init = true;
+    strm.next_in = input.data();
+    strm.avail_in = 0;
+}
+
+// Move unread input to the front of the buffer and read more. Returns the number of unread octets.
+size_t GzipFileSource::PrivateData::refill_input()
+{
+    if (strm.avail_in > 0 && strm.next_in != input.data()) {
+        std::memmove(input.data(), strm.next_in, strm.avail_in);
+    }
+    strm.next_in = input.data();
+    ifile.read((char*)input.data() + strm.avail_in, (std::streamsize)(input.size() - strm.avail_in));
+    strm.avail_in += (uInt)ifile.gcount();
+    return strm.avail_in;
+}
+
+// Called at the end of a gzip member. Returns true if another member follows.
+bool GzipFileSource::PrivateData::next_member()
+{
+    if (raw) {
+        // raw inflate stops before the gzip trailer (crc and length)
+        if (strm.avail_in < 8 && refill_input() < 8) {
+            return false;
+        }
+        strm.next_in += 8;
+        strm.avail_in -= 8;
+    }
+
+    if (strm.avail_in < 2) {
+        refill_input();
+    }
+    if (strm.avail_in < 2 || strm.next_in[0] != 0x1f || strm.next_in[1] != 0x8b) {
+        // end of file, or padding after the last member
+        return false;
+    }
+
+    if (inflateReset2(&strm, 31) != Z_OK) {
+        throw std::runtime_error(fmt::format("GzipFileSource: inflateReset2 failed for {}", filename));
+    }
+    raw = false;
+    return true;
+}
+
+void GzipFileSource::PrivateData::build_index()
+{
+    points.clear();
+
+    ifile.clear();
+    ifile.seekg(0, std::ios::beg);
+    init_inflate(47); // gzip or zlib header
+    raw = false;
+
+    std::vector<uint8_t> window(window_size);
+    uint64_t totin = 0;
+    uint64_t totout = 0;
+    uint64_t last = 0;
+
+    AccessPoint first;
+    first.member_start = true;
+    points.push_back(first);
+
+    strm.avail_out = 0;
+    for (;;) {
+        if (strm.avail_in == 0 && refill_input() == 0) {
+            throw std::runtime_error(fmt::format("GzipFileSource: unexpected end of file {}", filename));
+        }
+        if (strm.avail_out == 0) {
+            strm.next_out = window.data();
+            strm.avail_out = window_size;
+        }
+
+        totin += strm.avail_in;
+        totout += strm.avail_out;
+        const int ret = inflate(&strm, Z_BLOCK);
+        totin -= strm.avail_in;
+        totout -= strm.avail_out;
+
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+            throw std::runtime_error(fmt::format("GzipFileSource: error inflating {}: {}", filename, strm.msg ? strm.msg : "unknown error"));
+        }
+
+        if (ret == Z_STREAM_END) {
+            if (!next_member()) {
+                break;
+            }
+            AccessPoint point;
+            point.out = totout;
+            point.in = totin;
+            point.member_start = true;
+            points.push_back(point);
+            last = totout;
+            continue;
+        }
+
+        // at the end of a deflate block, not the last one
+        if ((strm.data_type & 128) && !(strm.data_type & 64) && totout - last > span) {
+            AccessPoint point;
+            point.out = totout;
+            point.in = totin;
+            point.bits = strm.data_type & 7;
+            point.window.resize(window_size);
+            const size_t left = strm.avail_out;
+            if (left > 0) {
+                std::memcpy(point.window.data(), window.data() + window_size - left, left);
+            }
+            if (left < window_size) {
+                std::memcpy(point.window.data() + left, window.data(), window_size - left);
+            }
+            points.push_back(std::move(point));
+            last = totout;
+        }
+    }
+
+    size = totout;
+
+    inflateEnd(&strm);
+    strm_init = false;
+}
+
+bool GzipFileSource::PrivateData::load_index()
+{
+    std::ifstream ixfile(GzipFileSource::index_filename(filename).c_str(), std::ios::in | std::ios::binary);
+    if (!ixfile) {
+        return false;
+    }
+
+    std::vector<uint8_t> header(gzindex_header_size);
+    ixfile.read((char*)header.data(), (std::streamsize)header.size());
+    if (!ixfile || std::memcmp(header.data(), gzindex_magic, sizeof(gzindex_magic)) != 0) {
+        return false;
+    }
+
+    const uint8_t* p = header.data() + sizeof(gzindex_magic);
+    const uint32_t version = (uint32_t)get_le(p, 4);
+    get_le(p, 4); // reserved
+    const uint64_t ix_file_size = get_le(p, 8);
+    const int64_t ix_file_mtime = (int64_t)get_le(p, 8);
+    const uint64_t ix_size = get_le(p, 8);
+    const uint64_t num_points = get_le(p, 8);
+
+    if (version != gzindex_version || ix_file_size != file_size || ix_file_mtime != file_mtime || num_points == 0) {
+        return false;
+    }
+
+    std::vector<AccessPoint> ix_points(num_points);
+    std::vector<uint8_t> buffer(gzindex_point_size);
+    for (auto& point : ix_points) {
+        ixfile.read((char*)buffer.data(), (std::streamsize)buffer.size());
+        if (!ixfile) {
+            return false;
+        }
+        p = buffer.data();
+        point.out = get_le(p, 8);
+        point.in = get_le(p, 8);
+        point.bits = (int)get_le(p, 1);
+        point.member_start = get_le(p, 1) != 0;
+        get_le(p, 2); // reserved
+        const size_t window_len = (size_t)get_le(p, 4);
+        if (window_len != 0 && window_len != window_size) {
+            return false;
+        }
+        point.window.resize(window_len);
+        ixfile.read((char*)point.window.data(), (std::streamsize)window_len);
+        if (!ixfile || point.out > ix_size || point.in > file_size || point.bits > 7) {
+            return false;
+        }
+    }
+
+    points.swap(ix_points);
+    size = ix_size;
+    return true;
+}
+
+void GzipFileSource::PrivateData::start_at(const AccessPoint& point)
+{
+    ifile.clear();
+    if (point.member_start) {
+        init_inflate(31);
+        raw = false;
+        ifile.seekg((std::streamoff)point.in, std::ios::beg);
+    } else {
+        init_inflate(-15);
+        raw = true;
+        ifile.seekg((std::streamoff)(point.in - (point.bits ? 1 : 0)), std::ios::beg);
+        if (point.bits) {
+            const int ch = ifile.get();
+            if (ch == EOF) {
+                throw std::runtime_error(fmt::format("GzipFileSource: unexpected end of file {}", filename));
+            }
+            inflatePrime(&strm, point.bits, ch >> (8 - point.bits));
+        }
+        if (!point.window.empty()) {
+            inflateSetDictionary(&strm, point.window.data(), (uInt)point.window.size());
+        }
+    }
+    out_pos = point.out;
+    at_end = false;
+}
+
+size_t GzipFileSource::PrivateData::inflate_output(uint8_t* out, const size_t len)
+{
+    strm.next_out = out;
+    strm.avail_out = (uInt)len;
+
+    while (strm.avail_out > 0 && !at_end) {
+        if (strm.avail_in == 0 && refill_input() == 0) {
+            throw std::runtime_error(fmt::format("GzipFileSource: unexpected end of file {}", filename));
+        }
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+            throw std::runtime_error(fmt::format("GzipFileSource: error inflating {}: {}", filename, strm.msg ? strm.msg : "unknown error"));
+        }
+        if (ret == Z_STREAM_END && !next_member()) {
+            at_end = true;
+        }
+    }
+
+    const size_t produced = len - strm.avail_out;
+    out_pos += produced;
+    return produced;
+}
+
+void GzipFileSource::PrivateData::next_chunk()
+{
+    std::swap(chunk, prev_chunk);
+    prev_chunk_start = chunk_start;
+    prev_chunk_len = chunk_len;
+
+    chunk.resize(chunk_size);
+    chunk_start = out_pos;
+    chunk_len = inflate_output(chunk.data(), chunk_size);
+    if (chunk_len == 0) {
+        throw std::runtime_error(fmt::format("GzipFileSource: read past the end of {}", filename));
+    }
+}
+
+GzipFileSource::GzipFileSource(const std::string& filename)
+    : d(new PrivateData)
+{
+    d->filename = filename;
+    d->input.resize(input_size);
+
+    d->ifile.open(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!d->ifile) {
+        throw std::runtime_error(fmt::format("Error opening file: {}", filename));
+    }
+
+    if (!file_size_and_mtime(filename, d->file_size, d->file_mtime) || !d->load_index()) {
+        d->build_index();
+    }
+}
+
+GzipFileSource::~GzipFileSource() = default;
+
+size_t GzipFileSource::size() const
+{
+    return (size_t)d->size;
+}
+
+void GzipFileSource::read(const size_t pos, const size_t len, uint8_t* buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (pos + len > d->size) {
+        throw std::runtime_error("GzipFileSource::read can not go past the end of the file");
+    }
+
+    size_t p = pos;
+    size_t remaining = len;
+    while (remaining > 0) {
+        if (p >= d->chunk_start && p < d->chunk_start + d->chunk_len) {
+            const size_t n = std::min(remaining, (size_t)(d->chunk_start + d->chunk_len - p));
+            std::memcpy(buffer, d->chunk.data() + (p - d->chunk_start), n);
+            buffer += n;
+            p += n;
+            remaining -= n;
+            continue;
+        }
+        if (p >= d->prev_chunk_start && p < d->prev_chunk_start + d->prev_chunk_len) {
+            const size_t n = std::min(remaining, (size_t)(d->prev_chunk_start + d->prev_chunk_len - p));
+            std::memcpy(buffer, d->prev_chunk.data() + (p - d->prev_chunk_start), n);
+            buffer += n;
+            p += n;
+            remaining -= n;
+            continue;
+        }
+
+        // continue inflating unless starting from an access point is closer
+        auto it = std::upper_bound(d->points.begin(), d->points.end(), (uint64_t)p,
+                                   [](const uint64_t value, const AccessPoint& point) { return value < point.out; });
+        --it;
+        if (!d->strm_init || p < d->out_pos || it->out > d->out_pos) {
+            d->start_at(*it);
+            d->chunk_len = 0;
+            d->prev_chunk_len = 0;
+        }
+        d->next_chunk();
+    }
+}
+
+void GzipFileSource::save_index() const
+{
+    size_t total = gzindex_header_size;
+    for (const auto& point : d->points) {
+        total += gzindex_point_size + point.window.size();
+    }
+
+    std::vector<uint8_t> buffer(total, 0);
+    uint8_t* p = buffer.data();
+
+    std::memcpy(p, gzindex_magic, sizeof(gzindex_magic));
+    p += sizeof(gzindex_magic);
+    put_le(p, gzindex_version, 4);
+    put_le(p, 0, 4); // reserved
+    put_le(p, d->file_size, 8);
+    put_le(p, (uint64_t)d->file_mtime, 8);
+    put_le(p, d->size, 8);
+    put_le(p, d->points.size(), 8);
+
+    for (const auto& point : d->points) {
+        put_le(p, point.out, 8);
+        put_le(p, point.in, 8);
+        put_le(p, (uint64_t)point.bits, 1);
+        put_le(p, point.member_start ? 1 : 0, 1);
+        put_le(p, 0, 2); // reserved
+        put_le(p, point.window.size(), 4);
+        if (!point.window.empty()) {
+            std::memcpy(p, point.window.data(), point.window.size());
+            p += point.window.size();
+        }
+    }
+
+    // write to a temporary file first, readers never see a partially written index
+    const std::string idx_filename = index_filename(d->filename);
+    const std::string tmp_filename = idx_filename + ".tmp";
+    {
+        std::ofstream ofile(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        ofile.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+        if (!ofile) {
+            throw std::runtime_error(fmt::format("GzipFileSource::save_index error writing {}", tmp_filename));
+        }
+    }
+    std::remove(idx_filename.c_str());
+    if (std::rename(tmp_filename.c_str(), idx_filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
+        throw std::runtime_error(fmt::format("GzipFileSource::save_index error renaming {} to {}", tmp_filename, idx_filename));
+    }
+}
+
+#else // DBUFR_WITH_ZLIB
+
+class GzipFileSource::PrivateData
+{
+};
+
+GzipFileSource::GzipFileSource(const std::string& filename)
+{
+    throw std::runtime_error(fmt::format("Can not read gzip compressed file {}, dbufr is built without zlib", filename));
+}
+
+GzipFileSource::~GzipFileSource() = default;
+
+size_t GzipFileSource::size() const
+{
+    return 0;
+}
+
+void GzipFileSource::read(const size_t /* pos */, const size_t /* len */, uint8_t* /* buffer */)
+{
+}
+
+void GzipFileSource::save_index() const
+{
+}
+
+#endif // DBUFR_WITH_ZLIB
+
+bool GzipFileSource::is_gzip(const std::string& filename)
+{
+    std::ifstream ifile(filename.c_str(), std::ios::in | std::ios::binary);
+    uint8_t magic[2] = {0, 0};
+    ifile.read((char*)magic, 2);
+    return ifile && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+std::string GzipFileSource::index_filename(const std::string& filename)
+{
+    return filename + ".gzidx";
+}
+
+const uint8_t* GzipFileSource::data() const
+{
+    return nullptr;
+}
@@ -0,0 +1,54 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "bufrsource.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Random access to the uncompressed content of a gzip file. Opening the file
+// inflates it once to record access points (stream position and the last 32 KiB
+// of output) every 1 MiB. A read inflates from the nearest access point, unless
+// it continues where the previous read stopped. Access points can be saved to
+// <filename>.gzidx and are reused while the file does not change.
+class GzipFileSource : public BUFRSource
+{
+public:
+    explicit GzipFileSource(const std::string& filename);
+    ~GzipFileSource() override;
+
+    static bool is_gzip(const std::string& filename);
+    static std::string index_filename(const std::string& filename);
+
+    size_t size() const override;
+    const uint8_t* data() const override;
+    void read(const size_t pos, const size_t len, uint8_t* buffer) override;
+
+    void save_index() const;
+
+private:
+    class PrivateData;
+    std::unique_ptr<PrivateData> d;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,220 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrindex.h"
+
+#include "bufrmessage.h"
+#include "bufrscanner.h"
+#include "bufrsource.h"
+#include "bufrutil.h"
+
+#include "fmt/format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const char index_magic[8] = {'D', 'B', 'U', 'F', 'R', 'I', 'D', 'X'};
+static const uint32_t index_version = 1;
+static const size_t header_size = 40;
+static const size_t entry_size = 32;
+
+std::string BUFRIndex::index_filename(const std::string& filename)
+{
+    return filename + ".idx";
+}
+
+bool BUFRIndex::load(const std::string& filename, const uint64_t data_size)
+{
+    entries.clear();
+
+    uint64_t file_size;
+    int64_t file_mtime;
+    if (!file_size_and_mtime(filename, file_size, file_mtime)) {
+        return false;
+    }
+
+    uint64_t index_size;
+    int64_t index_mtime;
+    if (!file_size_and_mtime(index_filename(filename), index_size, index_mtime) || index_size < header_size) {
+        return false;
+    }
+
+    std::ifstream ifile(index_filename(filename).c_str(), std::ios::in | std::ios::binary);
+    if (!ifile) {
+        return false;
+    }
+
+    std::vector<uint8_t> header(header_size);
+    ifile.read((char*)header.data(), (std::streamsize)header.size());
+    if (!ifile || std::memcmp(header.data(), index_magic, sizeof(index_magic)) != 0) {
+        return false;
+    }
+
+    const uint8_t* p = header.data() + sizeof(index_magic);
+    const uint32_t version = (uint32_t)get_le(p, 4);
+    get_le(p, 4); // reserved
+    const uint64_t size = get_le(p, 8);
+    const int64_t mtime = (int64_t)get_le(p, 8);
+    const uint64_t count = get_le(p, 8);
+
+    if (version != index_version || size != file_size || mtime != file_mtime) {
+        return false;
+    }
+    // a truncated or corrupt index must not make us allocate more than the file holds
+    if (count > (index_size - header_size) / entry_size) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(count * entry_size);
+    ifile.read((char*)buffer.data(), (std::streamsize)buffer.size());
+    if (!ifile) {
+        return false;
+    }
+
+    entries.resize(count);
+    p = buffer.data();
+    for (auto& e : entries) {
+        e.offset = get_le(p, 8);
+        e.length = (uint32_t)get_le(p, 4);
+        e.edition = (uint8_t)get_le(p, 1);
+        e.master_table_number = (uint8_t)get_le(p, 1);
+        e.originating_center = (uint16_t)get_le(p, 2);
+        e.originating_subcenter = (uint16_t)get_le(p, 2);
+        e.data_cat = (uint8_t)get_le(p, 1);
+        e.master_table_version = (uint8_t)get_le(p, 1);
+        e.local_table_version = (uint8_t)get_le(p, 1);
+        e.year = (uint16_t)get_le(p, 2);
+        e.month = (uint8_t)get_le(p, 1);
+        e.day = (uint8_t)get_le(p, 1);
+        e.hour = (uint8_t)get_le(p, 1);
+        e.minute = (uint8_t)get_le(p, 1);
+        e.second = (uint8_t)get_le(p, 1);
+        e.number_of_data_subsets = (uint16_t)get_le(p, 2);
+        e.flag_compressed = get_le(p, 1) != 0;
+        p++; // padding
+
+        if (e.offset > data_size || e.length > data_size - e.offset) {
+            entries.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BUFRIndex::save(const std::string& filename) const
+{
+    uint64_t file_size;
+    int64_t file_mtime;
+    if (!file_size_and_mtime(filename, file_size, file_mtime)) {
+        throw std::runtime_error(fmt::format("BUFRIndex::save can not stat file {}", filename));
+    }
+
+    std::vector<uint8_t> buffer(header_size + entries.size() * entry_size, 0);
+    uint8_t* p = buffer.data();
+
+    std::memcpy(p, index_magic, sizeof(index_magic));
+    p += sizeof(index_magic);
+    put_le(p, index_version, 4);
+    put_le(p, 0, 4); // reserved
+    put_le(p, file_size, 8);
+    put_le(p, (uint64_t)file_mtime, 8);
+    put_le(p, entries.size(), 8);
+
+    for (const auto& e : entries) {
+        put_le(p, e.offset, 8);
+        put_le(p, e.length, 4);
+        put_le(p, e.edition, 1);
+        put_le(p, e.master_table_number, 1);
+        put_le(p, e.originating_center, 2);
+        put_le(p, e.originating_subcenter, 2);
+        put_le(p, e.data_cat, 1);
+        put_le(p, e.master_table_version, 1);
+        put_le(p, e.local_table_version, 1);
+        put_le(p, e.year, 2);
+        put_le(p, e.month, 1);
+        put_le(p, e.day, 1);
+        put_le(p, e.hour, 1);
+        put_le(p, e.minute, 1);
+        put_le(p, e.second, 1);
+        put_le(p, e.number_of_data_subsets, 2);
+        put_le(p, e.flag_compressed ? 1 : 0, 1);
+        p++; // padding
+    }
+
+    // write to a temporary file first, readers never see a partially written index
+    const std::string idx_filename = index_filename(filename);
+    const std::string tmp_filename = idx_filename + ".tmp";
+    {
+        std::ofstream ofile(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        ofile.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+        if (!ofile) {
+            throw std::runtime_error(fmt::format("BUFRIndex::save error writing {}", tmp_filename));
+        }
+    }
+    std::remove(idx_filename.c_str());
+    if (std::rename(tmp_filename.c_str(), idx_filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
+        throw std::runtime_error(fmt::format("BUFRIndex::save error renaming {} to {}", tmp_filename, idx_filename));
+    }
+}
+
+void BUFRIndex::fill_entry(const BUFRMessage& bm, BUFRIndexEntry& entry)
+{
+    entry.edition = (uint8_t)bm.edition();
+    entry.master_table_number = (uint8_t)bm.master_table_number();
+    entry.originating_center = (uint16_t)bm.originating_center();
+    entry.originating_subcenter = (uint16_t)bm.originating_subcenter();
+    entry.data_cat = (uint8_t)bm.data_cat();
+    entry.master_table_version = (uint8_t)bm.master_table_version();
+    entry.local_table_version = (uint8_t)bm.local_table_version();
+    entry.year = (uint16_t)bm.year();
+    entry.month = (uint8_t)bm.month();
+    entry.day = (uint8_t)bm.day();
+    entry.hour = (uint8_t)bm.hour();
+    entry.minute = (uint8_t)bm.minute();
+    entry.second = (uint8_t)bm.second();
+    entry.number_of_data_subsets = (uint16_t)bm.number_of_data_subsets();
+    entry.flag_compressed = bm.flag_compressed();
+}
+
+void find_messages(const std::string& filename,
+                   BUFRSource& source,
+                   const unsigned int scan_threads,
+                   std::vector<size_t>& offset,
+                   std::vector<size_t>& length,
+                   std::vector<BUFRIndexEntry>& index_entries)
+{
+    BUFRIndex index;
+    if (index.load(filename, source.size()) && !index.entries.empty()) {
+        offset.reserve(index.entries.size());
+        length.reserve(index.entries.size());
+        for (const auto& e : index.entries) {
+            offset.push_back((size_t)e.offset);
+            length.push_back((size_t)e.length);
+        }
+        index_entries.swap(index.entries);
+    } else {
+        BUFRScanner::scan(source, scan_threads, offset, length);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BUFRMessage;
+class BUFRSource;
+
+struct BUFRIndexEntry {
+    uint64_t offset{0};
+    uint32_t length{0};
+
+    // key fields from sections 0, 1 and 3
+    uint8_t edition{0};
+    uint8_t master_table_number{0};
+    uint16_t originating_center{0};
+    uint16_t originating_subcenter{0};
+    uint8_t data_cat{0};
+    uint8_t master_table_version{0};
+    uint8_t local_table_version{0};
+    uint16_t year{0};
+    uint8_t month{0};
+    uint8_t day{0};
+    uint8_t hour{0};
+    uint8_t minute{0};
+    uint8_t second{0};
+    uint16_t number_of_data_subsets{0};
+    bool flag_compressed{false};
+};
+
+// Message offset index stored next to a BUFR file (<filename>.idx). It is only
+// valid as long as size and modification time of the BUFR file do not change.
+class BUFRIndex
+{
+public:
+    static std::string index_filename(const std::string& filename);
+
+    // Returns false if the index does not exist or is stale. Entries must lie within data_size,
+    // the size of the (uncompressed) data of the file.
+    bool load(const std::string& filename, const uint64_t data_size);
+    void save(const std::string& filename) const;
+
+    static void fill_entry(const BUFRMessage& bm, BUFRIndexEntry& entry);
+
+    std::vector<BUFRIndexEntry> entries;
+};
+
+// Message offsets of a file, from its index file if there is a valid one (index_entries are
+// filled in that case), otherwise from a scan of the source.
+void find_messages(const std::string& filename,
+                   BUFRSource& source,
+                   const unsigned int scan_threads,
+                   std::vector<size_t>& offset,
+                   std::vector<size_t>& length,
+                   std::vector<BUFRIndexEntry>& index_entries);
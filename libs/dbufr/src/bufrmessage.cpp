@@ -22,6 +22,8 @@
 #include "bufrmessage.h"
 #include "bufrdecoder.h"
 
+#include <stdexcept>
+
 BUFRMessage::~BUFRMessage()
 {
     delete m_decoder;
@@ -33,11 +35,41 @@ void BUFRMessage::parse(std::ifstream& ifile,
     if (m_parsed) {
         return;
     }
-    m_decoder = new BUFRDecoder();
+    reuse_decoder();
     m_decoder->parse(ifile, file_offset);
     m_parsed = true;
 }
 
+void BUFRMessage::parse(const std::shared_ptr<BUFRSource>& source,
+                        const size_t file_offset,
+                        const size_t len_bufr)
+{
+    if (m_parsed) {
+        return;
+    }
+    reuse_decoder();
+    m_decoder->parse(source, file_offset, len_bufr);
+    m_parsed = true;
+}
+
+void BUFRMessage::reset()
+{
+    if (m_decoder) {
+        m_decoder->reset();
+    }
+    m_parsed = false;
+}
+
+// The decoder of a previous message, also of a parse that threw, is reset rather than deleted.
+void BUFRMessage::reuse_decoder()
+{
+    if (m_decoder) {
+        m_decoder->reset();
+    } else {
+        m_decoder = new BUFRDecoder();
+    }
+}
+
 bool BUFRMessage::is_parsed() const
 {
     return m_parsed;
@@ -57,6 +89,15 @@ void BUFRMessage::set_tables(TableA* const tablea,
     m_decoder->set_tables(tablea, tableb, tabled, tablef);
 }
 
+void BUFRMessage::set_shared_tables(const TableA* const tablea,
+                                    const TableB* const tableb,
+                                    const TableD* const tabled,
+                                    const TableF* const tablef)
+{
+    assert(m_decoder);
+    m_decoder->set_shared_tables(tablea, tableb, tabled, tablef);
+}
+
 int BUFRMessage::load_tables()
 {
     assert(m_decoder);
@@ -99,12 +140,31 @@ void BUFRMessage::dump_section_5(std::ostream& ostr) const
     m_decoder->dump_section_5(ostr);
 }
 
+void BUFRMessage::set_projection(const std::vector<uint16_t>& descriptors,
+                                 const std::vector<std::string>& mnemonics)
+{
+    assert(m_decoder);
+    m_decoder->set_projection(descriptors, mnemonics);
+}
+
+void BUFRMessage::set_decode_threads(const unsigned int threads)
+{
+    assert(m_decoder);
+    m_decoder->set_decode_threads(threads);
+}
+
 void BUFRMessage::decode_data(NodeItem* const nodeitem)
 {
     assert(m_decoder);
     m_decoder->decode_section_4(nodeitem);
 }
 
+void BUFRMessage::decode_columns(BUFRColumns& columns)
+{
+    assert(m_decoder);
+    m_decoder->decode_columns(columns);
+}
+
 void BUFRMessage::get_values_for_subset(std::vector<std::vector<const NodeItem*>>& values_data_nodes,
                                         const unsigned int subset_num)
 {
@@ -112,6 +172,41 @@ void BUFRMessage::get_values_for_subset(std::vector<std::vector<const NodeItem*>
     m_decoder->get_values_for_subset(values_data_nodes, subset_num);
 }
 
+bool BUFRMessage::has_fixed_layout()
+{
+    assert(m_decoder);
+    return m_decoder->has_fixed_layout();
+}
+
+std::vector<uint16_t> BUFRMessage::layout_descriptors()
+{
+    assert(m_decoder);
+    return m_decoder->layout_descriptors();
+}
+
+Item::Value BUFRMessage::read_element(const size_t element, const unsigned int subset_num)
+{
+    assert(m_decoder);
+    if (subset_num == 0) {
+        throw std::runtime_error("BUFRMessage::read_element: subset_num is 1-based");
+    }
+    std::vector<Item::Value> values;
+    m_decoder->read_layout_elements(element, subset_num - 1, 1, values);
+    return std::move(values[0]);
+}
+
+void BUFRMessage::read_element_all_subsets(const size_t element, std::vector<Item::Value>& values)
+{
+    assert(m_decoder);
+    m_decoder->read_layout_elements(element, 0, m_decoder->m_number_of_data_subsets, values);
+}
+
+int BUFRMessage::edition() const
+{
+    assert(m_decoder);
+    return m_decoder->m_edition;
+}
+
 int BUFRMessage::master_table_number() const
 {
     assert(m_decoder);
@@ -148,6 +243,42 @@ int BUFRMessage::local_table_version() const
     return m_decoder->m_local_table_version;
 }
 
+int BUFRMessage::year() const
+{
+    assert(m_decoder);
+    return m_decoder->m_year;
+}
+
+int BUFRMessage::month() const
+{
+    assert(m_decoder);
+    return m_decoder->m_month;
+}
+
+int BUFRMessage::day() const
+{
+    assert(m_decoder);
+    return m_decoder->m_day;
+}
+
+int BUFRMessage::hour() const
+{
+    assert(m_decoder);
+    return m_decoder->m_hour;
+}
+
+int BUFRMessage::minute() const
+{
+    assert(m_decoder);
+    return m_decoder->m_minute;
+}
+
+int BUFRMessage::second() const
+{
+    assert(m_decoder);
+    return m_decoder->m_second;
+}
+
 unsigned int BUFRMessage::number_of_data_subsets() const
 {
     assert(m_decoder);
@@ -165,3 +296,14 @@ bool BUFRMessage::flag_compressed() const
     assert(m_decoder);
     return m_decoder->m_flag_compressed;
 }
+
+std::vector<uint16_t> BUFRMessage::data_descriptors() const
+{
+    assert(m_decoder);
+    std::vector<uint16_t> descriptors;
+    descriptors.reserve(m_decoder->m_data_descriptor_list.size());
+    for (const auto& fxy : m_decoder->m_data_descriptor_list) {
+        descriptors.push_back(fxy.as_int());
+    }
+    return descriptors;
+}
@@ -0,0 +1,156 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrprefetcher.h"
+
+#include "bufrsource.h"
+
+#include <algorithm>
+#include <chrono>
+
+BUFRPrefetcher::BUFRPrefetcher(const std::shared_ptr<BUFRSource>& source,
+                               const std::vector<size_t>& offset,
+                               const std::vector<size_t>& length,
+                               const unsigned int depth)
+    : m_source(source)
+    , m_offset(offset)
+    , m_length(length)
+    , m_depth(std::max(1u, depth))
+{
+    if (m_source->data() == nullptr) {
+        m_thread = std::thread(&BUFRPrefetcher::run, this);
+    }
+}
+
+BUFRPrefetcher::~BUFRPrefetcher()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+}
+
+void BUFRPrefetcher::run()
+{
+    for (;;) {
+        size_t i;
+        unsigned int generation;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || (m_queue.size() < m_depth && m_next_read < m_offset.size() && !m_error); });
+            if (m_stop) {
+                return;
+            }
+            i = m_next_read;
+            generation = m_generation;
+        }
+
+        std::shared_ptr<BUFRSource> message;
+        std::exception_ptr error;
+        try {
+            std::vector<uint8_t> bytes(m_length[i]);
+            m_source->read(m_offset[i], m_length[i], bytes.data());
+            message = std::make_shared<MemorySource>(std::move(bytes), m_offset[i]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // the reader moved to another message in the meantime
+            if (generation != m_generation) {
+                continue;
+            }
+            if (error) {
+                m_error = error;
+            } else {
+                m_queue.emplace_back(i, message);
+                m_next_read = i + 1;
+            }
+        }
+        m_cv.notify_all();
+    }
+}
+
+std::shared_ptr<BUFRSource> BUFRPrefetcher::get(const size_t i, size_t& pos)
+{
+    if (!m_thread.joinable()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.messages++;
+        if (!m_source->is_resident(m_offset[i], m_length[i])) {
+            m_stats.stalls++;
+        }
+        // ask for the following messages, the current one is faulted in by the decoder anyway
+        const size_t end = std::min(i + 1 + m_depth, m_offset.size());
+        const size_t start = std::max(i + 1, m_advised_end);
+        if (start < end) {
+            m_source->will_need(m_offset[start], m_offset[end - 1] + m_length[end - 1] - m_offset[start]);
+            m_advised_end = end;
+        }
+        pos = m_offset[i];
+        return m_source;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stats.messages++;
+
+    while (!m_queue.empty() && m_queue.front().first < i) {
+        m_queue.pop_front();
+    }
+
+    const bool queued = !m_queue.empty() && m_queue.front().first == i;
+    if (!queued && !(m_queue.empty() && m_next_read == i)) {
+        // not sequential, start reading from message i
+        m_queue.clear();
+        m_next_read = i;
+        m_generation++;
+        m_error = nullptr;
+    }
+    m_cv.notify_all();
+
+    if (!queued) {
+        m_stats.stalls++;
+        const auto start = std::chrono::steady_clock::now();
+        m_cv.wait(lock, [this, i] { return m_error || (!m_queue.empty() && m_queue.front().first == i); });
+        m_stats.stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    std::shared_ptr<BUFRSource> message = m_queue.front().second;
+    m_queue.pop_front();
+    lock.unlock();
+    m_cv.notify_all();
+
+    pos = 0;
+    return message;
+}
+
+BUFRReadStats BUFRPrefetcher::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
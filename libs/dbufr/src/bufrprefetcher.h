@@ -0,0 +1,80 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "bufrfile.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class BUFRSource;
+
+// Keeps the next few messages in memory while the current one is decoded. Memory
+// resident sources only get readahead hints, all others are read by an I/O thread
+// into a bounded queue of message buffers.
+class BUFRPrefetcher
+{
+public:
+    BUFRPrefetcher(const std::shared_ptr<BUFRSource>& source,
+                   const std::vector<size_t>& offset,
+                   const std::vector<size_t>& length,
+                   const unsigned int depth);
+    ~BUFRPrefetcher();
+
+    // Source and position from which message i (0-based) can be parsed.
+    std::shared_ptr<BUFRSource> get(const size_t i, size_t& pos);
+
+    BUFRReadStats stats() const;
+
+private:
+    BUFRPrefetcher(const BUFRPrefetcher&) = delete;
+    BUFRPrefetcher& operator=(BUFRPrefetcher const&) = delete;
+
+    void run();
+
+    std::shared_ptr<BUFRSource> m_source;
+    const std::vector<size_t>& m_offset;
+    const std::vector<size_t>& m_length;
+    const size_t m_depth;
+
+    // memory resident sources
+    size_t m_advised_end{0};
+
+    // I/O thread
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::pair<size_t, std::shared_ptr<BUFRSource>>> m_queue;
+    size_t m_next_read{0};
+    unsigned int m_generation{0};
+    bool m_stop{false};
+    std::exception_ptr m_error;
+
+    BUFRReadStats m_stats;
+};
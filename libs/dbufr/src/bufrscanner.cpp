@@ -0,0 +1,184 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrscanner.h"
+
+#include "bufrframing.h"
+#include "bufrsource.h"
+#include "bufrutil.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <thread>
+#include <utility>
+
+static const size_t block_size = 1024 * 1024;
+
+// smallest part of a file searched by one thread
+static const size_t min_chunk_size = 16 * 1024 * 1024;
+
+typedef std::vector<std::pair<size_t, size_t>> Candidates;
+
+// All valid messages starting in [chunk_start, chunk_end), including the ones
+// that overlap. The message itself may extend past the end of the chunk.
+static void find_candidates(const uint8_t* data, const size_t size,
+                            const size_t chunk_start, const size_t chunk_end,
+                            Candidates& candidates)
+{
+    if (chunk_start + 8 > size) {
+        return;
+    }
+
+    const uint8_t* const end = data + std::min(chunk_end, size - 7);
+    const uint8_t* p = data + chunk_start;
+
+    while ((p = find_bufr_marker(p, end)) != nullptr) {
+        const size_t pos = (size_t)(p - data);
+        const size_t len = check_bufr_section_0(p);
+        if (len > 0 && pos + len <= size && is_7777(p + len - 4)) {
+            candidates.emplace_back(pos, len);
+        }
+        p++;
+    }
+}
+
+BUFRScanner::BUFRScanner(BUFRSource& source)
+    : m_source(source)
+{
+}
+
+void BUFRScanner::load_block(const size_t pos)
+{
+    m_block_start = pos;
+    m_block_length = std::min(block_size, m_source.size() - pos);
+    m_block.resize(m_block_length);
+    m_source.read(m_block_start, m_block_length, m_block.data());
+}
+
+bool BUFRScanner::find(const size_t start_pos, size_t& pos, size_t& len_bufr)
+{
+    const size_t size = m_source.size();
+
+    if (m_source.data() != nullptr) {
+        return find_bufr(m_source.data(), size, start_pos, pos, len_bufr);
+    }
+
+    len_bufr = 0;
+    pos = start_pos;
+
+    while (pos + 8 <= size) {
+
+        if (pos < m_block_start || pos + 8 > m_block_start + m_block_length) {
+            load_block(pos);
+        }
+
+        const uint8_t* const block = m_block.data();
+        const size_t block_end = m_block_start + m_block_length;
+
+        // the whole Section 0 (8 octets) of a candidate must be in the block
+        const uint8_t* const p = find_bufr_marker(block + (pos - m_block_start), block + m_block_length - 7);
+        if (p == nullptr) {
+            pos = block_end - 7;
+            continue;
+        }
+
+        pos = m_block_start + (size_t)(p - block);
+
+        const size_t len = check_bufr_section_0(p);
+        if (len > 0 && pos + len <= size) {
+            const size_t pos7777 = pos + len - 4;
+            bool found;
+            if (pos7777 + 4 <= block_end) {
+                found = is_7777(block + (pos7777 - m_block_start));
+            } else {
+                std::array<uint8_t, 4> buf7777{};
+                m_source.read(pos7777, 4, buf7777.data());
+                found = is_7777(buf7777.data());
+            }
+            if (found) {
+                len_bufr = len;
+                return true;
+            }
+        }
+
+        pos++;
+    }
+
+    return false;
+}
+
+void BUFRScanner::scan(BUFRSource& source, const unsigned int num_threads,
+                       std::vector<size_t>& offset, std::vector<size_t>& length)
+{
+    const size_t size = source.size();
+
+    // framed files jump from record to record, the search is needed only if the framing breaks
+    size_t pos = 0;
+    const BUFRFraming framing = detect_framing(source);
+    if (framing.type != BUFRFraming::Type::None) {
+        pos = scan_framed(source, framing, offset, length);
+    }
+
+    size_t nthreads = num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::min(nthreads, size / min_chunk_size);
+
+    // chunks are searched in place, concurrent reads from other sources are not supported
+    if (nthreads <= 1 || source.data() == nullptr || pos > 0) {
+        BUFRScanner scanner(source);
+
+        while (pos < size) {
+            size_t len_bufr;
+            if (!scanner.find(pos, pos, len_bufr)) {
+                break;
+            }
+            offset.push_back(pos);
+            length.push_back(len_bufr);
+            pos = pos + len_bufr;
+        }
+        return;
+    }
+
+    const uint8_t* const data = source.data();
+    const size_t chunk_size = (size + nthreads - 1) / nthreads;
+
+    std::vector<Candidates> candidates(nthreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nthreads; t++) {
+        const size_t chunk_start = t * chunk_size;
+        const size_t chunk_end = std::min(size, chunk_start + chunk_size);
+        threads.emplace_back(find_candidates, data, size, chunk_start, chunk_end, std::ref(candidates[t]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // same result as the sequential search: candidates inside an accepted message are discarded
+    for (const auto& chunk_candidates : candidates) {
+        for (const auto& c : chunk_candidates) {
+            if (c.first >= pos) {
+                offset.push_back(c.first);
+                length.push_back(c.second);
+                pos = c.first + c.second;
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BUFRSource;
+
+// Finds consecutive BUFR messages in a BUFRSource. Memory resident sources are
+// searched in place, all others are read in large blocks which are reused between calls.
+class BUFRScanner
+{
+public:
+    explicit BUFRScanner(BUFRSource& source);
+
+    // Find the first valid message (Section 0, length and 7777) at or after start_pos.
+    bool find(const size_t start_pos, size_t& pos, size_t& len_bufr);
+
+    // Find all messages in the source. Fortran record and GTS bulletin framed files are
+    // scanned by following the framing (see bufrframing.h). Other memory resident sources
+    // larger than a few chunks are split between num_threads threads (0 means one per hardware thread).
+    static void scan(BUFRSource& source, const unsigned int num_threads,
+                     std::vector<size_t>& offset, std::vector<size_t>& length);
+
+private:
+    BUFRScanner(const BUFRScanner&) = delete;
+    BUFRScanner& operator=(BUFRScanner const&) = delete;
+
+    void load_block(const size_t pos);
+
+    BUFRSource& m_source;
+    std::vector<uint8_t> m_block;
+    size_t m_block_start{0};
+    size_t m_block_length{0};
+};
@@ -0,0 +1,292 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrsource.h"
+#include "bufrgzipsource.h"
+#include "bufrutil.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFileSource::~MappedFileSource()
+{
+#if !defined(_WIN32)
+    if (m_data != nullptr) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+}
+
+std::shared_ptr<MappedFileSource> MappedFileSource::open(const std::string& filename)
+{
+#if defined(_WIN32)
+    (void)filename;
+    return nullptr;
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const size_t size = (size_t)st.st_size;
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFileSource> source(new MappedFileSource);
+    source->m_data = static_cast<const uint8_t*>(addr);
+    source->m_size = size;
+    return source;
+#endif
+}
+
+size_t MappedFileSource::size() const
+{
+    return m_size;
+}
+
+const uint8_t* MappedFileSource::data() const
+{
+    return m_data;
+}
+
+void MappedFileSource::read(const size_t pos, const size_t len, uint8_t* buffer)
+{
+    if (pos + len > m_size) {
+        throw std::runtime_error("MappedFileSource::read can not go past the end of the file");
+    }
+    std::copy(m_data + pos, m_data + pos + len, buffer);
+}
+
+#if !defined(_WIN32)
+static size_t page_size()
+{
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+    return size;
+}
+#endif
+
+void MappedFileSource::will_need(const size_t pos, const size_t len)
+{
+#if !defined(_WIN32)
+    if (pos >= m_size) {
+        return;
+    }
+    const size_t start = pos - pos % page_size();
+    const size_t end = std::min(pos + len, m_size);
+    posix_madvise(const_cast<uint8_t*>(m_data) + start, end - start, POSIX_MADV_WILLNEED);
+#else
+    (void)pos;
+    (void)len;
+#endif
+}
+
+bool MappedFileSource::is_resident(const size_t pos, const size_t len) const
+{
+#if defined(__linux__)
+    if (pos >= m_size || len == 0) {
+        return true;
+    }
+    const size_t start = pos - pos % page_size();
+    const size_t end = std::min(pos + len, m_size);
+    std::vector<unsigned char> pages((end - start + page_size() - 1) / page_size());
+    if (mincore(const_cast<uint8_t*>(m_data) + start, end - start, pages.data()) != 0) {
+        return true;
+    }
+    for (const unsigned char page : pages) {
+        if ((page & 1U) == 0) {
+            return false;
+        }
+    }
+    return true;
+#else
+    (void)pos;
+    (void)len;
+    return true;
+#endif
+}
+
+PreadFileSource::~PreadFileSource()
+{
+#if !defined(_WIN32)
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+std::shared_ptr<PreadFileSource> PreadFileSource::open(const std::string& filename)
+{
+#if defined(_WIN32)
+    (void)filename;
+    return nullptr;
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::shared_ptr<PreadFileSource> source(new PreadFileSource);
+    source->m_fd = fd;
+    source->m_size = (size_t)st.st_size;
+    return source;
+#endif
+}
+
+size_t PreadFileSource::size() const
+{
+    return m_size;
+}
+
+const uint8_t* PreadFileSource::data() const
+{
+    return nullptr;
+}
+
+void PreadFileSource::read(const size_t pos, const size_t len, uint8_t* buffer)
+{
+#if !defined(_WIN32)
+    if (pos + len > m_size) {
+        throw std::runtime_error("PreadFileSource::read can not go past the end of the file");
+    }
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t n = ::pread(m_fd, buffer + done, len - done, (off_t)(pos + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("PreadFileSource::read failed");
+        }
+        done += (size_t)n;
+    }
+#else
+    (void)pos;
+    (void)len;
+    (void)buffer;
+#endif
+}
+
+StreamFileSource::StreamFileSource(const std::string& filename)
+{
+    m_ifile.open(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!m_ifile) {
+        std::ostringstream ostr;
+        ostr << "Error opening file: " << filename;
+        throw std::runtime_error(ostr.str());
+    }
+
+    m_ifile.seekg(0, std::ios::end);
+    m_size = (size_t)m_ifile.tellg();
+    m_ifile.seekg(0, std::ios::beg);
+}
+
+size_t StreamFileSource::size() const
+{
+    return m_size;
+}
+
+const uint8_t* StreamFileSource::data() const
+{
+    return nullptr;
+}
+
+void StreamFileSource::read(const size_t pos, const size_t len, uint8_t* buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    read_bufr(m_ifile, (std::ios::pos_type)pos, len, buffer);
+}
+
+MemorySource::MemorySource(std::vector<uint8_t>&& bytes, const uint64_t origin)
+    : m_bytes(std::move(bytes))
+    , m_origin(origin)
+{
+}
+
+void MemorySource::assign(const uint8_t* const first, const uint8_t* const last, const uint64_t origin)
+{
+    m_bytes.assign(first, last);
+    m_origin = origin;
+}
+
+size_t MemorySource::size() const
+{
+    return m_bytes.size();
+}
+
+const uint8_t* MemorySource::data() const
+{
+    return m_bytes.data();
+}
+
+void MemorySource::read(const size_t pos, const size_t len, uint8_t* buffer)
+{
+    if (pos + len > m_bytes.size()) {
+        throw std::runtime_error("MemorySource::read can not go past the end of the data");
+    }
+    std::copy(m_bytes.begin() + pos, m_bytes.begin() + pos + len, buffer);
+}
+
+uint64_t MemorySource::origin() const
+{
+    return m_origin;
+}
+
+std::shared_ptr<BUFRSource> open_bufr_source(const std::string& filename)
+{
+    if (GzipFileSource::is_gzip(filename)) {
+        return std::make_shared<GzipFileSource>(filename);
+    }
+
+    std::shared_ptr<BUFRSource> source = MappedFileSource::open(filename);
+    if (!source) {
+        source = PreadFileSource::open(filename);
+    }
+    if (!source) {
+        source = std::make_shared<StreamFileSource>(filename);
+    }
+    return source;
+}
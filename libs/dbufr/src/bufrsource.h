@@ -0,0 +1,150 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Random access to the raw bytes of a BUFR file.
+class BUFRSource
+{
+public:
+    BUFRSource() = default;
+    virtual ~BUFRSource() = default;
+
+    virtual size_t size() const = 0;
+
+    // Pointer to the whole content if the source is memory resident, nullptr otherwise.
+    virtual const uint8_t* data() const = 0;
+
+    virtual void read(const size_t pos, const size_t len, uint8_t* buffer) = 0;
+
+    // Offset of the first byte in the original file or stream, reported in message dumps.
+    virtual uint64_t origin() const
+    {
+        return 0;
+    }
+
+    // Hints for memory resident sources backed by a file.
+    virtual void will_need(const size_t pos, const size_t len)
+    {
+        (void)pos;
+        (void)len;
+    }
+    virtual bool is_resident(const size_t pos, const size_t len) const
+    {
+        (void)pos;
+        (void)len;
+        return true;
+    }
+
+private:
+    BUFRSource(const BUFRSource&) = delete;
+    BUFRSource& operator=(BUFRSource const&) = delete;
+};
+
+// Read-only memory mapping of a regular file.
+class MappedFileSource : public BUFRSource
+{
+public:
+    ~MappedFileSource() override;
+
+    // Returns nullptr if the file can not be mapped (pipe, device, empty file, unsupported platform...)
+    static std::shared_ptr<MappedFileSource> open(const std::string& filename);
+
+    size_t size() const override;
+    const uint8_t* data() const override;
+    void read(const size_t pos, const size_t len, uint8_t* buffer) override;
+    void will_need(const size_t pos, const size_t len) override;
+    bool is_resident(const size_t pos, const size_t len) const override;
+
+private:
+    MappedFileSource() = default;
+
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+};
+
+// Regular file read with pread, no shared file position: reads from several threads
+// run concurrently. Used for files that can not be mapped.
+class PreadFileSource : public BUFRSource
+{
+public:
+    ~PreadFileSource() override;
+
+    // Returns nullptr if the file can not be opened or is not a regular file, or on unsupported platforms
+    static std::shared_ptr<PreadFileSource> open(const std::string& filename);
+
+    size_t size() const override;
+    const uint8_t* data() const override;
+    void read(const size_t pos, const size_t len, uint8_t* buffer) override;
+
+private:
+    PreadFileSource() = default;
+
+    int m_fd{-1};
+    size_t m_size{0};
+};
+
+// std::ifstream backed source, used for inputs that can not be mapped or read with pread.
+class StreamFileSource : public BUFRSource
+{
+public:
+    explicit StreamFileSource(const std::string& filename);
+
+    size_t size() const override;
+    const uint8_t* data() const override;
+    void read(const size_t pos, const size_t len, uint8_t* buffer) override;
+
+private:
+    std::ifstream m_ifile;
+    std::mutex m_mutex; // reads may come from several threads, they all seek the same stream
+    size_t m_size{0};
+};
+
+// Bytes owned by the source, e.g. a single message read from a stream.
+class MemorySource : public BUFRSource
+{
+public:
+    MemorySource(std::vector<uint8_t>&& bytes, const uint64_t origin);
+
+    // Replace the bytes, keeping the capacity. Only while no message is parsed from this source.
+    void assign(const uint8_t* const first, const uint8_t* const last, const uint64_t origin);
+
+    size_t size() const override;
+    const uint8_t* data() const override;
+    void read(const size_t pos, const size_t len, uint8_t* buffer) override;
+    uint64_t origin() const override;
+
+private:
+    std::vector<uint8_t> m_bytes;
+    uint64_t m_origin{0};
+};
+
+// Gzip compressed files are inflated on demand (GzipFileSource). Others are
+// memory mapped if possible, std::ifstream otherwise.
+std::shared_ptr<BUFRSource> open_bufr_source(const std::string& filename);
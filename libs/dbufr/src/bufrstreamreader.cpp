@@ -0,0 +1,163 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrstreamreader.h"
+
+#include "bufrsource.h"
+#include "bufrtables.h"
+#include "bufrutil.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+static const size_t initial_buffer_size = 64 * 1024;
+
+class BUFRStreamReader::PrivateData
+{
+public:
+    explicit PrivateData(std::istream& input)
+        : istr(input)
+        , buffer(initial_buffer_size)
+    {
+    }
+
+    bool fill(const size_t num_bytes);
+
+    std::istream& istr;
+
+    // unread bytes are buffer[begin, end), buffer[0] is at stream offset buffer_offset
+    std::vector<uint8_t> buffer;
+    size_t begin{0};
+    size_t end{0};
+    uint64_t buffer_offset{0};
+
+    // bytes of the last message, reused unless that message is still parsed
+    std::shared_ptr<MemorySource> source{};
+
+    BUFRTables tables;
+    bool loading_table_messages{true};
+
+    unsigned int num_messages{0};
+    uint64_t message_offset{0};
+};
+
+// Make sure at least num_bytes unread bytes are in the buffer. Reads only what is
+// missing, so a message is returned as soon as its last byte arrives.
+bool BUFRStreamReader::PrivateData::fill(const size_t num_bytes)
+{
+    if (end - begin >= num_bytes) {
+        return true;
+    }
+
+    if (begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        buffer_offset += begin;
+        end -= begin;
+        begin = 0;
+    }
+
+    if (buffer.size() < num_bytes) {
+        buffer.resize(num_bytes);
+    }
+
+    while (end < num_bytes && istr) {
+        istr.read(reinterpret_cast<char*>(buffer.data() + end), (std::streamsize)(num_bytes - end));
+        end += (size_t)istr.gcount();
+    }
+
+    return end >= num_bytes;
+}
+
+BUFRStreamReader::BUFRStreamReader(std::istream& istr)
+    : d(new PrivateData(istr))
+{
+}
+
+BUFRStreamReader::~BUFRStreamReader() = default;
+
+bool BUFRStreamReader::next(BUFRMessage& bm)
+{
+    for (;;) {
+        if (!d->fill(8)) {
+            return false;
+        }
+
+        const uint8_t* marker = find_bufr_marker(d->buffer.data() + d->begin, d->buffer.data() + d->end - 3);
+        if (marker == nullptr) {
+            // keep the last 3 octets, they may be the beginning of the next "BUFR"
+            d->begin = d->end - 3;
+            if (!d->fill(4)) {
+                return false;
+            }
+            continue;
+        }
+
+        d->begin = (size_t)(marker - d->buffer.data());
+        if (!d->fill(8)) {
+            return false;
+        }
+
+        const size_t len_bufr = check_bufr_section_0(d->buffer.data() + d->begin);
+        if (len_bufr == 0 || !d->fill(len_bufr) || !is_7777(d->buffer.data() + d->begin + len_bufr - 4)) {
+            // not a valid message (or truncated at the end of the stream), resynchronise on the next "BUFR"
+            d->begin++;
+            continue;
+        }
+
+        d->message_offset = d->buffer_offset + d->begin;
+
+        const uint8_t* message = d->buffer.data() + d->begin;
+
+        // the decoder of the previous message is reused, and so is its source
+        // unless the previous message was moved out of bm
+        bm.reset();
+        if (!d->source || d->source.use_count() > 1) {
+            d->source = std::make_shared<MemorySource>(std::vector<uint8_t>(), d->message_offset);
+        }
+        d->source->assign(message, message + len_bufr, d->message_offset);
+        bm.parse(d->source, 0, len_bufr);
+
+        d->begin += len_bufr;
+        d->num_messages++;
+
+        if (d->loading_table_messages) {
+            d->loading_table_messages = d->tables.load_table_message(bm);
+        }
+        d->tables.set_tables_for(bm);
+        return true;
+    }
+}
+
+unsigned int BUFRStreamReader::num_messages() const
+{
+    return d->num_messages;
+}
+
+uint64_t BUFRStreamReader::message_offset() const
+{
+    return d->message_offset;
+}
+
+bool BUFRStreamReader::has_builtin_tables() const
+{
+    return d->tables.has_builtin_tables();
+}
@@ -0,0 +1,171 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bufrtables.h"
+
+#include "bufrmessage.h"
+#include "descriptortableb.h"
+
+TableVersions BUFRTables::versions_of(const BUFRMessage& bm)
+{
+    return TableVersions(bm.master_table_number(),
+                         bm.master_table_version(),
+                         bm.originating_center(),
+                         bm.originating_subcenter(),
+                         bm.local_table_version());
+}
+
+bool BUFRTables::load_table_message(BUFRMessage& bm)
+{
+    m_num_messages_seen++;
+
+    if (bm.data_cat() != 11) {
+        // done loading all data_cat == 11 messages
+        // assuming they are all at the beginning of the file before any other message
+        if (m_num_messages_seen == 1) {
+            read_from_db(bm);
+        }
+        return false;
+    }
+
+    if (m_num_messages_seen == 1) {
+        // add to TableB set of standard tableb descriptors used to build BUFR table entries
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 1, "TABLAE  ", "Table A: entry", "CCITT_IA5", 0, 0, 24));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 2, "TABLAD1 ", "Table A: data category description, line 1", "CCITT_IA5", 0, 0, 256));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 3, "TABLAD2 ", "Table A: data category description, line 2", "CCITT_IA5", 0, 0, 256));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 4, "MTABL   ", "BUFR/CREX Master table (see Note 1)", "CCITT_IA5", 0, 0, 16));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 5, "BUFREDN ", "BUFR/CREX edition number", "CCITT_IA5", 0, 0, 24));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 6, "BMTVN   ", "BUFR Master table Version number (see Note 2)", "CCITT_IA5", 0, 0, 16));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 7, "CMTVN   ", "CREX Master table version number (see Note 3)", "CCITT_IA5", 0, 0, 16));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 8, "BLTVN   ", "BUFR Local table version number (see Note 4)", "CCITT_IA5", 0, 0, 16));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 10, "FDESC   ", "F descriptor to be added or defined", "CCITT_IA5", 0, 0, 8));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 11, "XDESC   ", "X descriptor to be added or defined", "CCITT_IA5", 0, 0, 16));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 12, "YDESC   ", "Y descriptor to be added or defined", "CCITT_IA5", 0, 0, 24));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 13, "ELEMNA1 ", "Element name, line 1", "CCITT_IA5", 0, 0, 256));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 14, "ELEMNA2 ", "Element name, line 2", "CCITT_IA5", 0, 0, 256));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 15, "UNITSNA ", "Units name", "CCITT_IA5", 0, 0, 192));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 16, "SCALESG ", "Units scale sign", "CCITT_IA5", 0, 0, 8));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 17, "SCALEU  ", "Units scale", "CCITT_IA5", 0, 0, 24));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 18, "REFERSG ", "Units reference sign", "CCITT_IA5", 0, 0, 8));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 19, "REFERVA ", "Units reference value", "CCITT_IA5", 0, 0, 80));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 20, "ELEMDWD ", "Element data width", "CCITT_IA5", 0, 0, 24));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 24, "CODFIG  ", "Code figure", "CCITT_IA5", 0, 0, 64));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 25, "CODFIGM ", "Code figure meaning", "CCITT_IA5", 0, 0, 496));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 26, "BITNUM  ", "Bit number", "CCITT_IA5", 0, 0, 48));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 27, "BITNUMM ", "Bit number meaning", "CCITT_IA5", 0, 0, 496));
+        m_tableb.add_descriptor(DescriptorTableB(0, 0, 30, "DDSEQ   ", "Descriptor defining sequence", "CCITT_IA5", 0, 0, 48));
+
+        m_tablef.set_versions(bm.master_table_number(),
+                              bm.master_table_version(),
+                              bm.originating_center(),
+                              bm.originating_subcenter(),
+                              bm.local_table_version());
+    }
+
+    bm.set_tables(&m_tablea, &m_tableb, &m_tabled, &m_tablef);
+
+    if (bm.load_tables() == 0) {
+        return false;
+    }
+    m_num_table_messages++;
+    m_has_builtin_tables = true;
+    return true;
+}
+
+void BUFRTables::set_tables_for(BUFRMessage& bm)
+{
+    if (!m_has_builtin_tables) {
+        // reload tables in case different messages use different tables
+        if (m_curr_master_table_number != bm.master_table_number()
+            || m_curr_master_table_version != bm.master_table_version()
+            || m_curr_originating_center != bm.originating_center()
+            || m_curr_originating_subcenter != bm.originating_subcenter()
+            || m_curr_local_table_version != bm.local_table_version()) {
+            read_from_db(bm);
+        }
+    }
+
+    bm.set_shared_tables(&m_tablea, &m_tableb, &m_tabled, &m_tablef);
+}
+
+void BUFRTables::read_from_db(const BUFRMessage& bm)
+{
+    m_tableb.set_versions(bm.master_table_number(),
+                          bm.master_table_version(),
+                          bm.originating_center(),
+                          bm.originating_subcenter(),
+                          bm.local_table_version());
+    m_tableb.read_from_db();
+
+    m_tabled.set_versions(bm.master_table_number(),
+                          bm.master_table_version(),
+                          bm.originating_center(),
+                          bm.originating_subcenter(),
+                          bm.local_table_version());
+    m_tabled.read_from_db();
+
+    m_tablef.set_versions(bm.master_table_number(),
+                          bm.master_table_version(),
+                          bm.originating_center(),
+                          bm.originating_subcenter(),
+                          bm.local_table_version());
+    // m_tablef.read_from_db();
+
+    m_curr_master_table_number = bm.master_table_number();
+    m_curr_master_table_version = bm.master_table_version();
+    m_curr_originating_center = bm.originating_center();
+    m_curr_originating_subcenter = bm.originating_subcenter();
+    m_curr_local_table_version = bm.local_table_version();
+}
+
+unsigned int BUFRTables::num_table_messages() const
+{
+    return m_num_table_messages;
+}
+
+bool BUFRTables::has_builtin_tables() const
+{
+    return m_has_builtin_tables;
+}
+
+std::string BUFRTables::get_tableb_name() const
+{
+    return m_tableb.get_master_table_name() + "/" + m_tableb.get_local_table_name();
+}
+
+std::string BUFRTables::get_tabled_name() const
+{
+    return m_tabled.get_master_table_name() + "/" + m_tabled.get_local_table_name();
+}
+
+std::string BUFRTables::get_tablef_name() const
+{
+    return m_tablef.get_master_table_name() + "/" + m_tablef.get_local_table_name();
+}
+
+void BUFRTables::dump_tables(std::ostream& ostr)
+{
+    m_tablea.dump(ostr);
+    m_tabled.dump1(m_tablea, ostr);
+    m_tableb.dump1(ostr);
+    m_tabled.dump2(m_tableb, ostr);
+    m_tableb.dump2(ostr);
+}
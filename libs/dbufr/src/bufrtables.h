@@ -0,0 +1,89 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "tablea.h"
+#include "tableb.h"
+#include "tabled.h"
+#include "tablef.h"
+
+#include <ostream>
+#include <string>
+#include <tuple>
+
+class BUFRMessage;
+
+// master table number, master table version, originating center, originating subcenter, local table version
+typedef std::tuple<int, int, int, int, int> TableVersions;
+
+// Tables shared by all messages read from one file or stream. Messages are
+// either decoded with tables from the database, reloaded whenever table versions
+// change, or with NCEP style tables embedded in the data category 11 messages
+// at the beginning of the file.
+//
+// Data messages get the tables as shared and read-only, so once the table messages
+// are loaded, messages attached to the same tables can be decoded by several threads.
+// Calls of set_tables_for itself must be serialized by the caller.
+class BUFRTables
+{
+public:
+    BUFRTables() = default;
+
+    static TableVersions versions_of(const BUFRMessage& bm);
+
+    // Call for messages in file order, starting with the first, until it returns false.
+    // Returns true if bm was a table message whose content was added to the tables.
+    bool load_table_message(BUFRMessage& bm);
+
+    // Reload tables from the database if needed and attach them to bm as shared tables.
+    void set_tables_for(BUFRMessage& bm);
+
+    unsigned int num_table_messages() const;
+    bool has_builtin_tables() const;
+
+    std::string get_tableb_name() const;
+    std::string get_tabled_name() const;
+    std::string get_tablef_name() const;
+
+    void dump_tables(std::ostream& ostr);
+
+private:
+    BUFRTables(const BUFRTables&) = delete;
+    BUFRTables& operator=(BUFRTables const&) = delete;
+
+    void read_from_db(const BUFRMessage& bm);
+
+    int m_curr_master_table_number{-1};
+    int m_curr_master_table_version{-1};
+    int m_curr_originating_center{-1};
+    int m_curr_originating_subcenter{-1};
+    int m_curr_local_table_version{-1};
+
+    TableA m_tablea;
+    TableB m_tableb;
+    TableD m_tabled;
+    TableF m_tablef;
+
+    unsigned int m_num_messages_seen{0};
+    unsigned int m_num_table_messages{0};
+    bool m_has_builtin_tables{false};
+};
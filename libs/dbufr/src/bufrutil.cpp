@@ -22,63 +22,131 @@
 #include "bufrutil.h"
 #include "bitutils.h"
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
+#include <vector>
 
-std::ios::pos_type seek_bufr(std::ifstream& file, const std::ios::pos_type start_pos, size_t& len_bufr)
+#include <sys/stat.h>
+
+static const size_t scan_block_size = 1024 * 1024;
+
+const uint8_t* find_bufr_marker(const uint8_t* begin, const uint8_t* end)
 {
-    std::array<unsigned char, 4> buffer{};
-    std::array<unsigned char, 4> buf7777{};
+    // 'end' is one past the last position at which the marker may start,
+    // at least 3 octets after it must be readable
+    const uint8_t* p = begin;
+    while (p < end) {
+        p = static_cast<const uint8_t*>(std::memchr(p, 'B', end - p));
+        if (p == nullptr) {
+            return nullptr;
+        }
+        if (p[1] == 'U' && p[2] == 'F' && p[3] == 'R') {
+            return p;
+        }
+        p++;
+    }
+    return nullptr;
+}
 
-    // look for "BUFR" in the first 1024 bytes starting at start_pos
+size_t check_bufr_section_0(const uint8_t* sec0)
+{
+    const int edition = C1INT(sec0 + 7);
+    if (edition != 2 && edition != 3 && edition != 4) {
+        return 0;
+    }
 
-    std::ios::pos_type pos = start_pos;
-    len_bufr = 0;
+    const size_t len_bufr = C3UINT(sec0 + 4);
 
-    file.seekg(0, std::ios::end);
-    const std::ios::pos_type file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    // minimum number of bits in any BUFR message is 368
+    // see "Guide to WMO Table Driven Code Forms"
+    if (len_bufr < 46) {
+        return 0;
+    }
 
-    while (!file.eof() && pos < start_pos + (std::ios::off_type)1024 && pos < file_size - (std::ios::off_type)4) {
+    return len_bufr;
+}
 
-        file.seekg(pos, std::ios::beg);
-        file.read((char*)&buffer, 4);
+bool is_7777(const uint8_t* buffer)
+{
+    return buffer[0] == '7' && buffer[1] == '7' && buffer[2] == '7' && buffer[3] == '7';
+}
 
-        if (buffer[0] == 'B' && buffer[1] == 'U' && buffer[2] == 'F' && buffer[3] == 'R') {
+std::ios::pos_type seek_bufr(std::ifstream& file, const std::ios::pos_type start_pos, size_t& len_bufr)
+{
+    // read the file in blocks and look for a valid "BUFR" ... "7777" message in memory.
+    // start small, usually the message is right at start_pos, and grow the block while searching
+    std::vector<uint8_t> block(4096);
+    std::ios::pos_type block_pos = start_pos;
 
-            file.read((char*)&buffer, 4);
-            if ((int)buffer[3] == 2 || (int)buffer[3] == 3 || (int)buffer[3] == 4) {
+    len_bufr = 0;
 
-                len_bufr = C3UINT(buffer);
+    for (;;) {
+        file.clear();
+        file.seekg(block_pos, std::ios::beg);
+        file.read((char*)block.data(), (std::streamsize)block.size());
+        const size_t nread = (size_t)file.gcount();
+        file.clear();
 
-                // minimum number of bits in any BUFR message is 368
-                // see "Guide to WMO Table Driven Code Forms"
-                if (len_bufr < 46) {
-                    throw std::runtime_error("len_bufr < 46");
-                }
+        if (nread < 8) {
+            return -1;
+        }
 
-                if (pos + (std::ios::pos_type)len_bufr <= file_size) {
-                    file.seekg(pos + (std::ios::pos_type)(len_bufr - 4));
-                    file.read((char*)&buf7777, 4);
-                    if (buf7777[0] == '7' && buf7777[1] == '7' && buf7777[2] == '7' && buf7777[3] == '7') {
-                        return pos;
-                    }
-                    throw std::runtime_error("Can not find 7777");
+        const uint8_t* const begin = block.data();
+        const uint8_t* const end = begin + nread - 7;
+        const uint8_t* p = begin;
+
+        while ((p = find_bufr_marker(p, end)) != nullptr) {
+            const size_t len = check_bufr_section_0(p);
+            if (len > 0) {
+                const std::ios::pos_type pos = block_pos + (std::ios::off_type)(p - begin);
+                std::array<uint8_t, 4> buf7777{};
+                file.seekg(pos + (std::ios::off_type)(len - 4), std::ios::beg);
+                file.read((char*)buf7777.data(), 4);
+                const bool found = file.gcount() == 4 && is_7777(buf7777.data());
+                file.clear();
+                if (found) {
+                    len_bufr = len;
+                    return pos;
                 }
-                throw std::runtime_error("EOF before 7777");
             }
-            std::ostringstream ostr;
-            ostr << "seek_bufr error: unknown bufr edition " << (int)buffer[3];
-            throw std::runtime_error(ostr.str());
+            p++;
         }
-        if (!file.eof()) {
-            pos = pos + (std::ios::off_type)1;
+
+        if (nread < block.size()) {
+            return -1;
         }
+
+        // keep the last 7 octets, a marker may span the two blocks
+        block_pos = block_pos + (std::ios::off_type)(nread - 7);
+        block.resize(std::min(2 * block.size(), scan_block_size));
     }
-    return -1;
+}
+
+bool find_bufr(const uint8_t* data, const size_t size, const size_t start_pos, size_t& pos, size_t& len_bufr)
+{
+    len_bufr = 0;
+
+    if (start_pos + 8 > size) {
+        return false;
+    }
+
+    const uint8_t* const end = data + size - 7;
+    const uint8_t* p = data + start_pos;
+
+    while ((p = find_bufr_marker(p, end)) != nullptr) {
+        const size_t len = check_bufr_section_0(p);
+        if (len > 0 && (size_t)(p - data) + len <= size && is_7777(p + len - 4)) {
+            pos = (size_t)(p - data);
+            len_bufr = len;
+            return true;
+        }
+        p++;
+    }
+    return false;
 }
 
 void read_bufr(std::ifstream& file, const std::ios::pos_type pos, const size_t len_bufr, uint8_t* buffer)
@@ -97,3 +165,30 @@ void read_bufr(std::ifstream& file, const std::ios::pos_type pos, const size_t l
         throw std::runtime_error("read_bufr error: file.fail() after read");
     }
 }
+
+bool file_size_and_mtime(const std::string& filename, uint64_t& size, int64_t& mtime)
+{
+    struct stat st {};
+    if (stat(filename.c_str(), &st) != 0) {
+        return false;
+    }
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+void put_le(uint8_t*& p, const uint64_t v, const int octets)
+{
+    for (int i = 0; i < octets; i++) {
+        *p++ = (uint8_t)(v >> (8 * i));
+    }
+}
+
+uint64_t get_le(const uint8_t*& p, const int octets)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < octets; i++) {
+        v |= (uint64_t)(*p++) << (8 * i);
+    }
+    return v;
+}
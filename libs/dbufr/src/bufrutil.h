@@ -21,8 +21,21 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <string>
+
+const uint8_t* find_bufr_marker(const uint8_t* begin, const uint8_t* end);
+size_t check_bufr_section_0(const uint8_t* sec0);
+bool is_7777(const uint8_t* buffer);
 
 std::ios::pos_type seek_bufr(std::ifstream& file, const std::ios::pos_type start_pos, size_t& len_bufr);
 void read_bufr(std::ifstream& file, const std::ios::pos_type pos, const size_t len_bufr, uint8_t* buffer);
+bool find_bufr(const uint8_t* data, const size_t size, const size_t start_pos, size_t& pos, size_t& len_bufr);
+
+bool file_size_and_mtime(const std::string& filename, uint64_t& size, int64_t& mtime);
+
+// little-endian integers in index files
+void put_le(uint8_t*& p, const uint64_t v, const int octets);
+uint64_t get_le(const uint8_t*& p, const int octets);
@@ -0,0 +1,69 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Decimal scale of an element value: value = mantissa * 10^-scale, with the
+// scale after the operators 2 02 YYY and 2 07 YYY. Powers of ten come from a
+// table. Up to 10^22 they are exact in double, so one multiplication (scale <= 0)
+// or division (scale > 0) gives the correctly rounded value: mantissa 27315 with
+// scale 2 is 273.15, not 273.15000000000003 as with mantissa * 0.01.
+class DecimalScale
+{
+public:
+    explicit DecimalScale(const int scale);
+
+    double apply(const double mantissa) const
+    {
+        return m_divide ? mantissa / m_factor : mantissa * m_factor;
+    }
+
+    // Inverse of apply, the mantissa of a value
+    double mantissa(const double value) const
+    {
+        return m_divide ? value * m_factor : value / m_factor;
+    }
+
+    double factor() const
+    {
+        return m_factor;
+    }
+
+    bool divide() const
+    {
+        return m_divide;
+    }
+
+    int scale() const
+    {
+        return m_scale;
+    }
+
+private:
+    double m_factor{1.0}; // 10^|scale|
+    int m_scale{0};
+    bool m_divide{false};
+};
+
+// 10^n for 0 <= n, infinity above the range of double
+double power_of_ten(const int n);
@@ -0,0 +1,373 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "decodeprogram.h"
+
+#include "bitutils.h"
+#include "tableb.h"
+#include "tabled.h"
+
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+static const size_t default_cache_capacity = 256;
+
+// deeper nesting is a recursive Table D definition
+static const int max_sequence_depth = 64;
+
+// thrown while compiling a list the recursive decoder should handle
+class NotCompilable
+{
+};
+
+std::shared_ptr<const DecodeProgram> DecodeProgram::compile(const std::vector<FXY>& descriptor_list,
+                                                           const TableD& tabled,
+                                                           const TableB& tableb)
+{
+    std::shared_ptr<DecodeProgram> program = std::make_shared<DecodeProgram>();
+    try {
+        program->compile_list(descriptor_list, tabled, 0);
+    } catch (const NotCompilable&) {
+        return nullptr;
+    } catch (const std::runtime_error&) {
+        // unknown sequence, the recursive decoder reports it
+        return nullptr;
+    }
+    program->compute_layout(tableb);
+    return program;
+}
+
+// Same traversal as BUFRDecoder::read_descriptor_list
+void DecodeProgram::compile_list(const std::vector<FXY>& descriptor_list, const TableD& tabled, const int depth)
+{
+    if (depth > max_sequence_depth) {
+        throw NotCompilable();
+    }
+
+    size_t desc = 0;
+    while (desc < descriptor_list.size()) {
+        const FXY fxy = descriptor_list[desc];
+        const int f = fxy.f();
+        const int x = fxy.x();
+        const int y = fxy.y();
+
+        const size_t index = ops.size();
+        ops.emplace_back();
+        ops[index].fxy = fxy;
+
+        if (f == 0) {
+            ops[index].kind = DecodeOp::Kind::Element;
+        } else if (f == 1) {
+            if (y == 0) {
+                // delayed, the next descriptor is the replication factor 0 31 000, 0 31 001 or 0 31 002
+                if (desc + 1 >= descriptor_list.size()) {
+                    throw NotCompilable();
+                }
+                const FXY next_desc = descriptor_list[desc + 1];
+                if (next_desc.f() != 0 || next_desc.x() != 31 || next_desc.y() > 2) {
+                    throw NotCompilable();
+                }
+                ops[index].kind = DecodeOp::Kind::DelayedReplication;
+                ops[index].fxy_next = next_desc;
+                desc++;
+            } else {
+                ops[index].kind = DecodeOp::Kind::Replication;
+            }
+            if (desc + x >= descriptor_list.size()) {
+                throw NotCompilable();
+            }
+            const std::vector<FXY> iter_list(descriptor_list.begin() + desc + 1, descriptor_list.begin() + desc + 1 + x);
+            compile_list(iter_list, tabled, depth);
+            desc = desc + x;
+        } else if (f == 2) {
+            ops[index].kind = DecodeOp::Kind::Operator;
+            ops[index].fxy_next = (desc + 1) < descriptor_list.size() ? descriptor_list[desc + 1] : FXY(0);
+        } else if (f == 3) {
+            if (x == 0 && (y == 3 || y == 4)) {
+                // Table D or Table B entry, changes the tables while decoding
+                throw NotCompilable();
+            } else if (x == 60 && (y == 1 || y == 2 || y == 3 || y == 4)) {
+                if (desc + 1 >= descriptor_list.size()) {
+                    throw NotCompilable();
+                }
+                ops[index].kind = DecodeOp::Kind::DRP;
+                compile_list(std::vector<FXY>(1, descriptor_list[desc + 1]), tabled, depth);
+                desc++;
+            } else {
+                const DescriptorTableD& desc_d = tabled.get_decriptor(fxy);
+                ops[index].kind = DecodeOp::Kind::Sequence;
+                ops[index].description = desc_d.description();
+                std::vector<FXY> sub_sequence;
+                sub_sequence.reserve(desc_d.sequence().size());
+                for (const auto& s : desc_d.sequence()) {
+                    sub_sequence.emplace_back(s.fxy());
+                }
+                compile_list(sub_sequence, tabled, depth + 1);
+            }
+        } else {
+            throw NotCompilable();
+        }
+
+        ops[index].next = (uint32_t)ops.size();
+        desc++;
+    }
+}
+
+// Operator state of the layout, same as in BUFRDecoder
+struct LayoutState {
+    int new_data_width{0};
+    int new_scale{0};
+    int increase_scale_ref_width{0};
+    int new_ccitt_width{0};
+    size_t offset{0};
+};
+
+static bool layout_ops(const std::vector<DecodeOp>& ops,
+                       const size_t first,
+                       const size_t last,
+                       const unsigned int iterations,
+                       const TableB& tableb,
+                       LayoutState& state,
+                       std::vector<LayoutElement>& layout)
+{
+    for (unsigned int iter = 0; iter < iterations; iter++) {
+        size_t i = first;
+        while (i < last) {
+            const DecodeOp& op = ops[i];
+            switch (op.kind) {
+            case DecodeOp::Kind::Element: {
+                const DescriptorTableB& desc = tableb.get_decriptor(op.fxy);
+                LayoutElement element;
+                element.fxy = op.fxy;
+                element.offset = (uint32_t)state.offset;
+                int bit_width = desc.bit_width();
+                if (!desc.is_numeric_data()) {
+                    element.is_string = true;
+                    if (state.new_ccitt_width > 0) {
+                        bit_width = state.new_ccitt_width;
+                    }
+                } else {
+                    int scale = desc.scale();
+                    int reference = desc.reference();
+                    if (desc.is_data()) {
+                        scale += state.new_scale;
+                        bit_width += state.new_data_width;
+                        if (state.increase_scale_ref_width > 0) {
+                            scale = scale + state.increase_scale_ref_width;
+                            reference = reference * int_pow(10, state.increase_scale_ref_width);
+                            bit_width = bit_width + ((10 * state.increase_scale_ref_width) + 2) / 3;
+                        }
+                    }
+                    // wider elements can not be read
+                    if (bit_width > 32) {
+                        return false;
+                    }
+                    element.reference = reference;
+                    element.scale = DecimalScale(scale);
+                }
+                if (bit_width <= 0 || bit_width > 0xffff) {
+                    // unknown element
+                    return false;
+                }
+                element.bits = (uint16_t)bit_width;
+                state.offset += bit_width;
+                if (state.offset > UINT32_MAX) {
+                    return false;
+                }
+                layout.push_back(element);
+                break;
+            }
+            case DecodeOp::Kind::Replication:
+                if (!layout_ops(ops, i + 1, op.next, op.fxy.y(), tableb, state, layout)) {
+                    return false;
+                }
+                break;
+            case DecodeOp::Kind::Sequence:
+                if (!layout_ops(ops, i + 1, op.next, 1, tableb, state, layout)) {
+                    return false;
+                }
+                break;
+            case DecodeOp::Kind::Operator: {
+                const int x = op.fxy.x();
+                const int y = op.fxy.y();
+                if (x == 1) {
+                    state.new_data_width = y == 0 ? 0 : y - 128;
+                } else if (x == 2) {
+                    state.new_scale = y == 0 ? 0 : y - 128;
+                } else if (x == 7) {
+                    state.increase_scale_ref_width = y;
+                } else if (x == 8) {
+                    state.new_ccitt_width = y * 8;
+                } else {
+                    // data dependent or not an element of the layout
+                    return false;
+                }
+                break;
+            }
+            case DecodeOp::Kind::DelayedReplication:
+            case DecodeOp::Kind::DRP:
+                return false;
+            }
+            i = op.next;
+        }
+    }
+    return true;
+}
+
+void DecodeProgram::compute_layout(const TableB& tableb)
+{
+    LayoutState state;
+    std::vector<LayoutElement> elements;
+    if (layout_ops(ops, 0, ops.size(), 1, tableb, state, elements)) {
+        fixed_layout = true;
+        layout = std::move(elements);
+        subset_bits = state.offset;
+    }
+}
+
+struct ProgramKey {
+    uint64_t tabled_generation{0};
+    uint64_t tableb_generation{0};
+    std::vector<uint16_t> descriptors;
+
+    bool operator==(const ProgramKey& other) const
+    {
+        return tabled_generation == other.tabled_generation && tableb_generation == other.tableb_generation && descriptors == other.descriptors;
+    }
+};
+
+struct ProgramKeyHash {
+    size_t operator()(const ProgramKey& key) const
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+        auto mix = [&h](const uint64_t v) {
+            h ^= v;
+            h *= 1099511628211ULL;
+        };
+        mix(key.tabled_generation);
+        mix(key.tableb_generation);
+        for (const uint16_t v : key.descriptors) {
+            mix(v);
+        }
+        return (size_t)h;
+    }
+};
+
+typedef std::pair<ProgramKey, std::shared_ptr<const DecodeProgram>> CacheEntry;
+
+class DecodeProgramCache::PrivateData
+{
+public:
+    mutable std::mutex mutex;
+    size_t capacity{default_cache_capacity};
+    // most recently used first
+    std::list<CacheEntry> entries;
+    std::unordered_map<ProgramKey, std::list<CacheEntry>::iterator, ProgramKeyHash> map;
+    uint64_t hits{0};
+    uint64_t misses{0};
+
+    void evict()
+    {
+        while (entries.size() > capacity) {
+            map.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+DecodeProgramCache::DecodeProgramCache()
+    : d(new PrivateData)
+{
+}
+
+DecodeProgramCache::~DecodeProgramCache() = default;
+
+DecodeProgramCache& DecodeProgramCache::instance()
+{
+    static DecodeProgramCache cache;
+    return cache;
+}
+
+std::shared_ptr<const DecodeProgram> DecodeProgramCache::get(const std::vector<FXY>& descriptor_list,
+                                                             const TableD& tabled,
+                                                             const TableB& tableb)
+{
+    ProgramKey key;
+    key.tabled_generation = tabled.generation();
+    key.tableb_generation = tableb.generation();
+    key.descriptors.reserve(descriptor_list.size());
+    for (const FXY fxy : descriptor_list) {
+        key.descriptors.push_back(fxy.as_int());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        auto it = d->map.find(key);
+        if (it != d->map.end()) {
+            d->entries.splice(d->entries.begin(), d->entries, it->second);
+            d->hits++;
+            return it->second->second;
+        }
+        d->misses++;
+    }
+
+    // compile outside of the lock, two threads may compile the same list
+    std::shared_ptr<const DecodeProgram> program = DecodeProgram::compile(descriptor_list, tabled, tableb);
+
+    std::lock_guard<std::mutex> lock(d->mutex);
+    auto it = d->map.find(key);
+    if (it != d->map.end()) {
+        return it->second->second;
+    }
+    d->entries.emplace_front(key, program);
+    d->map.emplace(std::move(key), d->entries.begin());
+    d->evict();
+    return program;
+}
+
+void DecodeProgramCache::set_capacity(const size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->capacity = capacity;
+    d->evict();
+}
+
+size_t DecodeProgramCache::size() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->entries.size();
+}
+
+uint64_t DecodeProgramCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->hits;
+}
+
+uint64_t DecodeProgramCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->misses;
+}
@@ -0,0 +1,117 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "decimalscale.h"
+#include "fxy.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TableB;
+class TableD;
+
+// One descriptor of an expanded Section 3 descriptor list.
+// Replications, DRP* and sequences are followed by their body: ops [index + 1, next).
+struct DecodeOp {
+    enum class Kind : uint8_t {
+        Element,
+        Replication,
+        DelayedReplication,
+        Operator,
+        Sequence,
+        DRP
+    };
+
+    Kind kind{Kind::Element};
+    FXY fxy{0};
+    FXY fxy_next{0}; // operators: next descriptor in the list, delayed replication: 0 31 YYY
+    uint32_t next{0};
+    std::string description; // sequences: Table D description
+};
+
+// Element of a fixed layout, at the same bit offset in every subset of uncompressed data.
+// Width, scale and reference include the operators 2 01, 2 02, 2 07 and 2 08.
+struct LayoutElement {
+    FXY fxy{0};
+    uint32_t offset{0}; // bits from the start of the subset
+    uint16_t bits{0};
+    bool is_string{false};
+    int reference{0};
+    DecimalScale scale{0};
+};
+
+// Section 3 descriptor list with all Table D sequences, replications and DRP* expanded
+// into one flat array. Element descriptors are looked up in Table B while decoding, the
+// operators are applied while decoding, same as in the recursive decoder.
+class DecodeProgram
+{
+public:
+    // Compile the list with sequences from tabled. Returns nullptr if the list can not be
+    // compiled (Table B/D entries in data category 11 messages, unknown sequences, invalid
+    // replications), such messages are decoded recursively.
+    static std::shared_ptr<const DecodeProgram> compile(const std::vector<FXY>& descriptor_list,
+                                                        const TableD& tabled,
+                                                        const TableB& tableb);
+
+    std::vector<DecodeOp> ops;
+
+    // Lists without delayed replication, DRP* and operators other than 2 01, 2 02, 2 07 and 2 08
+    // have a fixed layout: the same element widths in every subset.
+    bool fixed_layout{false};
+    std::vector<LayoutElement> layout;
+    size_t subset_bits{0};
+
+private:
+    void compile_list(const std::vector<FXY>& descriptor_list, const TableD& tabled, const int depth);
+    void compute_layout(const TableB& tableb);
+};
+
+// Process wide LRU cache of compiled programs, keyed by the descriptor list and the
+// Table B and D generations (which change whenever the tables do).
+class DecodeProgramCache
+{
+public:
+    static DecodeProgramCache& instance();
+
+    // Cached or newly compiled program, nullptr if the list can not be compiled.
+    std::shared_ptr<const DecodeProgram> get(const std::vector<FXY>& descriptor_list,
+                                             const TableD& tabled,
+                                             const TableB& tableb);
+
+    void set_capacity(const size_t capacity);
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    DecodeProgramCache();
+    ~DecodeProgramCache();
+    DecodeProgramCache(const DecodeProgramCache&) = delete;
+    DecodeProgramCache& operator=(DecodeProgramCache const&) = delete;
+
+    class PrivateData;
+    std::unique_ptr<PrivateData> d;
+};
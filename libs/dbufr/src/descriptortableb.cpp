@@ -23,6 +23,30 @@
 #include "string_utils.h"
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Returns the shared instance for the given metadata. Instances are never
+// freed, so items can keep pointers to them after the tables are reloaded.
+static const Item::ElementInfo* intern_element_info(const std::string& mnemonic,
+                                                    const std::string& unit,
+                                                    const std::string& description)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<Item::ElementInfo>> pool;
+
+    std::string key;
+    key.reserve(mnemonic.size() + unit.size() + description.size() + 2);
+    key.append(mnemonic).append(1, '\0').append(unit).append(1, '\0').append(description);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Item::ElementInfo>& info = pool[key];
+    if (!info) {
+        info.reset(new Item::ElementInfo{mnemonic, unit, description});
+    }
+    return info.get();
+}
 
 DescriptorTableB::DescriptorTableB(int f,
                                    int x,
@@ -50,6 +74,8 @@ DescriptorTableB::DescriptorTableB(int f,
     m_is_code = upcase_unit.substr(0, 4) == "CODE";
     m_is_flag = upcase_unit.substr(0, 4) == "FLAG";
     m_is_data = !m_is_code && !m_is_flag;
+
+    m_element_info = intern_element_info(this->mnemonic(), m_unit, this->description());
 }
 
 const std::string& DescriptorTableB::unit() const
@@ -57,6 +83,14 @@ const std::string& DescriptorTableB::unit() const
     return m_unit;
 }
 
+const Item::ElementInfo* DescriptorTableB::element_info() const
+{
+    if (m_element_info == nullptr) { // default constructed descriptor
+        return intern_element_info(mnemonic(), m_unit, description());
+    }
+    return m_element_info;
+}
+
 int DescriptorTableB::scale() const
 {
     return m_scale;
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "descriptor.h"
+#include "item.h"
 
 class DescriptorTableB : public Descriptor
 {
@@ -43,6 +44,8 @@ public:
     DescriptorTableB& operator=(DescriptorTableB&&) noexcept = default;
 
     const std::string& unit() const;
+    // mnemonic, unit and description interned for sharing between items
+    const Item::ElementInfo* element_info() const;
     int scale() const;
     int reference() const;
     int bit_width() const;
@@ -54,6 +57,7 @@ public:
 
 private:
     std::string m_unit;
+    const Item::ElementInfo* m_element_info{nullptr};
     int m_scale{0};
     int m_reference{0};
     int m_bit_width{0};
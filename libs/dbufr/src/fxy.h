@@ -89,14 +89,13 @@ public:
     {
         return v;
     }
+    // "FXXYYY", short enough for the small string buffer, so nothing is allocated
     std::string as_str() const
     {
-        std::ostringstream strstrm;
-        strstrm << std::setfill('0')
-                << std::setw(1) << f()
-                << std::setw(2) << x()
-                << std::setw(3) << y();
-        return strstrm.str();
+        const char text[6] = {char('0' + f()),
+                              char('0' + x() / 10), char('0' + x() % 10),
+                              char('0' + y() / 100), char('0' + y() / 10 % 10), char('0' + y() % 10)};
+        return std::string(text, 6);
     }
 
 private:
@@ -0,0 +1,39 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "item.h"
+
+std::string Item::decimal_string(const int64_t mantissa, const int scale)
+{
+    const bool negative = mantissa < 0;
+    std::string digits = std::to_string(negative ? 0 - (uint64_t)mantissa : (uint64_t)mantissa);
+    if (scale <= 0) {
+        if (mantissa != 0) {
+            digits.append((size_t)-scale, '0');
+        }
+    } else {
+        if (digits.size() <= (size_t)scale) {
+            digits.insert(0, (size_t)scale + 1 - digits.size(), '0');
+        }
+        digits.insert(digits.size() - (size_t)scale, 1, '.');
+    }
+    return negative ? "-" + digits : digits;
+}
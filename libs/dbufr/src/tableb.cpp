@@ -26,11 +26,20 @@
 
 #include "fmt/format.h"
 
+#include <atomic>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 
+static std::atomic<uint64_t> tableb_generation{0};
+
+static uint64_t next_generation()
+{
+    return ++tableb_generation;
+}
+
 TableB::TableB()
+    : m_generation(next_generation())
 {
 #ifdef USE_VECTOR
     m_tableb.resize(65535);
@@ -48,6 +57,7 @@ void TableB::set_versions(const int master_table_number,
     m_originating_center = originating_center;
     m_originating_subcenter = originating_subcenter;
     m_local_table_version = local_table_version;
+    m_generation = next_generation();
 
     std::ostringstream ostr;
     ostr << "b_master_table";
@@ -75,6 +85,7 @@ void TableB::add_descriptor(const DescriptorTableB& desc)
 #else
     m_tableb[fxy] = desc;
 #endif
+    m_generation = next_generation();
 }
 
 const DescriptorTableB& TableB::get_decriptor(const FXY fxy) const
@@ -116,6 +127,31 @@ bool TableB::exists_decriptor(const FXY fxy) const
 #endif
 }
 
+// Mnemonics of NCEP table messages are padded with blanks to 8 characters
+static bool same_mnemonic(const std::string& a, const std::string& b)
+{
+    size_t len_a = a.size();
+    while (len_a > 0 && a[len_a - 1] == ' ') {
+        len_a--;
+    }
+    size_t len_b = b.size();
+    while (len_b > 0 && b[len_b - 1] == ' ') {
+        len_b--;
+    }
+    return len_a == len_b && a.compare(0, len_a, b, 0, len_b) == 0;
+}
+
+bool TableB::search_mnemonic(const std::string& mnemonic, FXY& fxy) const
+{
+    for (const auto& i : m_insertion_order) {
+        if (same_mnemonic(get_decriptor(i).mnemonic(), mnemonic)) {
+            fxy = i;
+            return true;
+        }
+    }
+    return false;
+}
+
 void TableB::dump1(std::ostream& ostr)
 {
     ostr << "|          |        |                                                          |" << '\n';
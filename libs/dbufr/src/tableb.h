@@ -24,6 +24,7 @@
 #include "descriptortableb.h"
 #include "sqlite3.h"
 
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -44,6 +45,13 @@ public:
     const DescriptorTableB& get_decriptor(const FXY fxy) const;
     bool search_decriptor(const FXY fxy, DescriptorTableB& desc) const;
     bool exists_decriptor(const FXY fxy) const;
+    bool search_mnemonic(const std::string& mnemonic, FXY& fxy) const;
+
+    // Changes whenever the table is modified, unique across all tables.
+    uint64_t generation() const
+    {
+        return m_generation;
+    }
 
     void dump1(std::ostream& ostr);
     void dump2(std::ostream& ostr);
@@ -67,6 +75,7 @@ private:
     TableB& operator=(TableB const&) = delete;
 
     std::vector<FXY> m_insertion_order;
+    uint64_t m_generation{0};
 #ifdef USE_VECTOR
     std::vector<DescriptorTableB> m_tableb;
 #else
@@ -30,13 +30,22 @@
 #include "fmt/format.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <vector>
 
+static std::atomic<uint64_t> tabled_generation{0};
+
+static uint64_t next_generation()
+{
+    return ++tabled_generation;
+}
+
 TableD::TableD()
+    : m_generation(next_generation())
 {
     m_tdskip.emplace_back(3, 60, 1); // DRP16BIT
     m_tdskip.emplace_back(3, 60, 2); // DRP8BIT
@@ -55,6 +64,7 @@ void TableD::set_versions(const int master_table_number,
     m_originating_center = originating_center;
     m_originating_subcenter = originating_subcenter;
     m_local_table_version = local_table_version;
+    m_generation = next_generation();
 
     std::ostringstream ostr;
     ostr << "d_master_table";
@@ -74,6 +84,7 @@ void TableD::set_versions(const int master_table_number,
 void TableD::add_descriptor(const DescriptorTableD& desc)
 {
     m_tabled.push_back(desc);
+    m_generation = next_generation();
 }
 
 const DescriptorTableD& TableD::get_decriptor(const FXY fxy) const
@@ -24,6 +24,7 @@
 #include "descriptortabled.h"
 #include "sqlite3.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,12 @@ public:
     const DescriptorTableD& get_decriptor(const FXY fxy) const;
     bool search_descriptor(const FXY fxy, DescriptorTableD& desc) const;
 
+    // Changes whenever the table is modified, unique across all tables.
+    uint64_t generation() const
+    {
+        return m_generation;
+    }
+
     void dump1(const TableA& ta, std::ostream& ostr) const;
     void dump2(const TableB& tb, std::ostream& ostr) const;
 
@@ -68,6 +75,7 @@ private:
 
     std::vector<DescriptorTableD> m_tabled;
     std::vector<FXY> m_tdskip;
+    uint64_t m_generation{0};
 
     int m_master_table_number{-1};
     int m_master_table_version{-1};
@@ -82,7 +82,7 @@ const std::string& TableF::get_local_table_name() const
     return f_local_table_name;
 }
 
-void TableF::open_db()
+void TableF::open_db() const
 {
     std::string dbfile;
     if (const char* db_env = std::getenv("DBUFR_DB_DIR")) {
@@ -100,8 +100,9 @@ void TableF::open_db()
     }
 }
 
-void TableF::populate_code_flags(std::map<uint64_t, std::string>& code_meaning, const std::map<FXY, double>& b_descriptors)
+void TableF::populate_code_flags(std::map<uint64_t, std::string>& code_meaning, const std::map<FXY, double>& b_descriptors) const
 {
+    std::lock_guard<std::mutex> lock(m_db_mutex);
     if (m_db == nullptr) {
         open_db();
     }
@@ -112,8 +113,9 @@ void TableF::populate_code_flags(std::map<uint64_t, std::string>& code_meaning,
     populate_code_flags_from_table(f_master_table_name, code_meaning, b_descriptors);
 }
 
-std::string TableF::get_code_meaning(const FXY fxy, int code)
+std::string TableF::get_code_meaning(const FXY fxy, int code) const
 {
+    std::lock_guard<std::mutex> lock(m_db_mutex);
     if (m_db == nullptr) {
         open_db();
     }
@@ -124,9 +126,22 @@ std::string TableF::get_code_meaning(const FXY fxy, int code)
     return get_code_meaning_from_table(f_master_table_name, fxy, code);
 }
 
+void TableF::get_condition_descriptors(const FXY fxy, std::vector<FXY>& conditions) const
+{
+    std::lock_guard<std::mutex> lock(m_db_mutex);
+    if (m_db == nullptr) {
+        open_db();
+    }
+
+    if (m_local_table_version != 0) {
+        get_condition_descriptors_from_table(f_local_table_name, fxy, conditions);
+    }
+    get_condition_descriptors_from_table(f_master_table_name, fxy, conditions);
+}
+
 void TableF::populate_code_flags_from_table(const std::string& table_name,
                                             std::map<uint64_t, std::string>& code_meaning,
-                                            const std::map<FXY, double>& b_descriptors)
+                                            const std::map<FXY, double>& b_descriptors) const
 {
     int rc;
 
@@ -221,7 +236,40 @@ void TableF::populate_code_flags_from_table(const std::string& table_name,
     }
 }
 
-std::string TableF::get_code_meaning_from_table(const std::string& table_name, const FXY fxy, int code)
+void TableF::get_condition_descriptors_from_table(const std::string& table_name, const FXY fxy, std::vector<FXY>& conditions) const
+{
+    sqlite3_stmt* statement;
+
+    std::ostringstream ostr;
+    ostr << "SELECT DISTINCT dep_fxy FROM " << table_name;
+    ostr << " WHERE fxy = \"" << fxy.as_str() << "\" AND dep_fxy != \"\"";
+
+    int rc = sqlite3_prepare(m_db, ostr.str().c_str(), -1, &statement, nullptr);
+    if (rc != SQLITE_OK) {
+        std::ostringstream estr;
+        estr << __FILE__ << " " << __LINE__ << '\n';
+        estr << "SQL error: sqlite3_prepare rc=" << rc << " " << sqlite3_errmsg(m_db) << '\n';
+        estr << ostr.str();
+        throw std::runtime_error(estr.str());
+    }
+
+    while ((rc = sqlite3_step(statement)) == SQLITE_ROW) {
+        const std::string dep_fxy = (const char*)sqlite3_column_text(statement, 0);
+        conditions.emplace_back(dep_fxy);
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "SQL error:  sqlite3_step " << '\n';
+    }
+
+    rc = sqlite3_finalize(statement);
+    if (rc != SQLITE_OK) {
+        std::ostringstream estr;
+        estr << "Error sqlite3_finalize: " << sqlite3_errmsg(m_db);
+        throw std::runtime_error(estr.str());
+    }
+}
+
+std::string TableF::get_code_meaning_from_table(const std::string& table_name, const FXY fxy, int code) const
 {
     std::string code_meaning;
     sqlite3_stmt* statement;
@@ -25,7 +25,9 @@
 #include "sqlite3.h"
 
 #include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 class TableF
 {
@@ -42,8 +44,11 @@ public:
     const std::string& get_master_table_name() const;
     const std::string& get_local_table_name() const;
 
-    void populate_code_flags(std::map<uint64_t, std::string>& code_meaning, const std::map<FXY, double>& b_descriptors);
-    std::string get_code_meaning(const FXY fxy, int code);
+    // Safe to call from several threads, queries of the shared connection are serialized.
+    void populate_code_flags(std::map<uint64_t, std::string>& code_meaning, const std::map<FXY, double>& b_descriptors) const;
+    std::string get_code_meaning(const FXY fxy, int code) const;
+    // Elements the meanings of a conditional code or flag table depend on, appended to conditions
+    void get_condition_descriptors(const FXY fxy, std::vector<FXY>& conditions) const;
 
     bool read_from_file_eccodes(sqlite3* db,
                                 const bool is_master,
@@ -56,7 +61,8 @@ private:
     TableF(const TableF&) = delete;
     TableF& operator=(TableF const&) = delete;
 
-    sqlite3* m_db{nullptr};
+    mutable sqlite3* m_db{nullptr};
+    mutable std::mutex m_db_mutex;
 
     int m_master_table_number{-1};
     int m_master_table_version{-1};
@@ -67,12 +73,13 @@ private:
     std::string f_master_table_name;
     std::string f_local_table_name;
 
-    void open_db();
-    std::string get_code_meaning_from_table(const std::string& table_name, const FXY fxy, int code);
+    void open_db() const;
+    std::string get_code_meaning_from_table(const std::string& table_name, const FXY fxy, int code) const;
+    void get_condition_descriptors_from_table(const std::string& table_name, const FXY fxy, std::vector<FXY>& conditions) const;
 
     void populate_code_flags_from_table(const std::string& table_name,
                                         std::map<uint64_t, std::string>& code_meaning,
-                                        const std::map<FXY, double>& b_descriptors);
+                                        const std::map<FXY, double>& b_descriptors) const;
 
     static void create_table(sqlite3* db, const std::string& table_name);
     static void insert_row(sqlite3* db,
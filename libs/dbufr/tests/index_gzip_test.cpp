@@ -0,0 +1,138 @@
+/*
+  xbufr - bufr file viewer
+
+  Copyright (c) 2015 - present, Dusan Jovic
+
+  This file is part of xbufr.
+
+  xbufr is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  xbufr is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with xbufr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// A message index written for a gzip file holds offsets in the uncompressed data, which
+// are beyond the size of the file itself. Reopening the file must use the index.
+
+#include "bufrgzipsource.h"
+#include "bufrindex.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <vector>
+
+static void put_octets(std::vector<uint8_t>& m, const uint64_t value, const int octets)
+{
+    for (int i = octets - 1; i >= 0; i--) {
+        m.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+// Edition 4 message with one subset of a 0 01 001 element and a long zero filled Section 4
+static std::vector<uint8_t> make_message(const size_t sec4_length)
+{
+    std::vector<uint8_t> m = {'B', 'U', 'F', 'R', 0, 0, 0, 4};
+
+    put_octets(m, 22, 3); // Section 1
+    std::vector<uint8_t> sec1(19, 0);
+    sec1[10] = 33;
+    sec1[12] = 2024 >> 8;
+    sec1[13] = 2024 & 0xff;
+    sec1[14] = 1;
+    sec1[15] = 1;
+    m.insert(m.end(), sec1.begin(), sec1.end());
+
+    put_octets(m, 10, 3); // Section 3
+    m.push_back(0);
+    put_octets(m, 1, 2);
+    m.push_back(0x80);
+    put_octets(m, 0x0101, 2);
+    m.push_back(0);
+
+    put_octets(m, sec4_length, 3); // Section 4
+    m.resize(m.size() + sec4_length - 3, 0);
+
+    m.insert(m.end(), {'7', '7', '7', '7'});
+
+    const size_t len = m.size();
+    m[4] = (uint8_t)(len >> 16);
+    m[5] = (uint8_t)(len >> 8);
+    m[6] = (uint8_t)len;
+    return m;
+}
+
+static int fail(const char* message)
+{
+    std::fprintf(stderr, "index_gzip_test: %s\n", message);
+    return 1;
+}
+
+int main()
+{
+    const std::string filename = "index_gzip_test.bufr.gz";
+
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < 3; i++) {
+        const std::vector<uint8_t> m = make_message(20000 + i * 1000);
+        data.insert(data.end(), m.begin(), m.end());
+    }
+
+    gzFile gz = gzopen(filename.c_str(), "wb");
+    if (gz == nullptr || gzwrite(gz, data.data(), (unsigned int)data.size()) != (int)data.size() || gzclose(gz) != Z_OK) {
+        return fail("can not write the gzip file");
+    }
+    struct stat st {};
+    if (stat(filename.c_str(), &st) != 0 || (size_t)st.st_size >= data.size()) {
+        return fail("the gzip file is not smaller than its data");
+    }
+    std::remove(BUFRIndex::index_filename(filename).c_str());
+    std::remove(GzipFileSource::index_filename(filename).c_str());
+
+    std::vector<size_t> offset;
+    std::vector<size_t> length;
+    std::vector<BUFRIndexEntry> entries;
+    {
+        GzipFileSource source(filename);
+        find_messages(filename, source, 1, offset, length, entries);
+    }
+    if (offset.size() != 3 || !entries.empty()) {
+        return fail("the messages were not found by a scan");
+    }
+
+    BUFRIndex index;
+    index.entries.resize(offset.size());
+    for (size_t i = 0; i < offset.size(); i++) {
+        index.entries[i].offset = offset[i];
+        index.entries[i].length = (uint32_t)length[i];
+        index.entries[i].data_cat = (uint8_t)(100 + i);
+    }
+    index.save(filename);
+
+    std::vector<size_t> indexed_offset;
+    std::vector<size_t> indexed_length;
+    {
+        GzipFileSource source(filename);
+        find_messages(filename, source, 1, indexed_offset, indexed_length, entries);
+    }
+
+    std::remove(BUFRIndex::index_filename(filename).c_str());
+    std::remove(filename.c_str());
+
+    if (entries.size() != 3 || entries[2].data_cat != 102) {
+        return fail("the index was not used");
+    }
+    if (indexed_offset != offset || indexed_length != length) {
+        return fail("the index has different offsets than the scan");
+    }
+    return 0;
+}